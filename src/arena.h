@@ -0,0 +1,43 @@
+/** @file
+ * Pomocnicze funkcje do rozmieszczania buforów gry w jednym obszarze
+ * pamięci.
+ *
+ * Wielkość obszaru jest liczona przed alokacją jako suma wielkości buforów,
+ * z których każdy zaczyna się pod adresem wyrównanym do @ref ARENA_ALIGN.
+ *
+ * @author Jakub Bedełek
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+
+/**
+ * Wyrównanie każdego bufora w obszarze pamięci, równe długości linii
+ * pamięci podręcznej.
+ */
+#define ARENA_ALIGN 64
+
+/** @brief Zaokrągla @p bytes w górę do wielokrotności @ref ARENA_ALIGN.
+ * @param[in] bytes   - liczba bajtów.
+ * @return Zwraca najmniejszą wielokrotność @ref ARENA_ALIGN niemniejszą
+ * od @p bytes.
+ */
+static inline uint64_t arena_align(uint64_t bytes) {
+   return (bytes + ARENA_ALIGN - 1) & ~(uint64_t)(ARENA_ALIGN - 1);
+}
+
+/** @brief Wydziela z obszaru pamięci bufor o wielkości @p bytes.
+ * @param[in,out] mem - wskaźnik na początek wolnej części obszaru,
+ *                      przesuwany za wydzielony bufor,
+ * @param[in] bytes   - wielkość bufora.
+ * @return Zwraca wskaźnik na wydzielony bufor.
+ */
+static inline void *arena_take(char **mem, uint64_t bytes) {
+   void *buffer = *mem;
+   *mem += arena_align(bytes);
+   return buffer;
+}
+
+#endif /* ARENA_H */
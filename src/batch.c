@@ -218,6 +218,17 @@ static bool new_mode(bool batch_mode) {
     }
 }
 
+/** @brief Wypisuje kolejną część opisu planszy na standardowe wyjście.
+ * @param[in] ctx     - strumień wyjściowy,
+ * @param[in] data    - część opisu planszy,
+ * @param[in] length  - liczba znaków części.
+ * @return Zwraca true jeśli udało się wypisać wszystkie znaki lub false
+ * w przeciwnym przypadku.
+ */
+static bool print_chunk(void *ctx, const char *data, size_t length) {
+    return fwrite(data, 1, length, ctx) == length;
+}
+
 /** @brief Funkcja odpowiedzialna za uruchomienie wpisanej komendy.
  * @param[in] letter - komenda występująca na początku linii.
  * @return Zwraca wartość funkcji odpowiedniej dla danej komendy lub false
@@ -255,13 +266,11 @@ static uint32_t start_commands(char letter[]) {
     }
     else if (strcmp(letter, "p") == 0 && batch.g_end == 0 && batch.b_batch) {
         batch.show = true;
-        char *board = gamma_board(batch.g);
-        if (board == NULL) {
+        // Plansza jest wypisywana częściami, bez tworzenia całego napisu.
+        if (!gamma_board_write(batch.g, print_chunk, stdout)) {
             batch.bug = true;
             return false;
         }
-        printf("%s", board); 
-        free(board);  
         return true;
     }
     else {
@@ -0,0 +1,209 @@
+/** @file
+ * Implementacja interfejsu planszy przechowującej właścicieli pól.
+ *
+ * @author Jakub Bedełek
+ */
+
+#include "board.h"
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Liczba pól opisywanych przez jedno słowo maski.
+ */
+#define WORD_BITS 64
+
+/**
+ * Generuje funkcję board_word_<bits>_scalar zwracającą maskę @ref WORD_BITS
+ * pól typu @p type, zaczynając od pola @p c, o wartości value.
+ */
+#define BOARD_WORD_SCALAR(type, bits)                                         \
+static inline uint64_t board_word_##bits##_scalar(const type *c,              \
+                                                  uint64_t count,             \
+                                                  uint32_t value) {           \
+   uint64_t word = 0;                                                         \
+   for (uint64_t k = 0; k < count; k++)                                       \
+      word |= (uint64_t)(c[k] == value) << k;                                 \
+   return word;                                                               \
+}
+
+BOARD_WORD_SCALAR(uint8_t, 8)
+BOARD_WORD_SCALAR(uint16_t, 16)
+BOARD_WORD_SCALAR(uint32_t, 32)
+
+/** @brief Zwraca maskę @ref WORD_BITS pól jednobajtowych o wartości
+ * @p value. Porównuje 32 (AVX2) lub 16 (SSE2) pól jedną instrukcją.
+ * @param[in] c       - pierwsze pole,
+ * @param[in] value   - szukana wartość.
+ * @return Zwraca maskę, w której bit k opisuje pole c[k].
+ */
+static inline uint64_t board_word_8(const uint8_t *c, uint32_t value) {
+#if defined(__AVX2__)
+   __m256i v = _mm256_set1_epi8((char)value);
+   uint64_t lo = (uint32_t)_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)c), v));
+   uint64_t hi = (uint32_t)_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(c + 32)), v));
+   return lo | hi << 32;
+#elif defined(__SSE2__)
+   __m128i v = _mm_set1_epi8((char)value);
+   uint64_t word = 0;
+   for (int k = 0; k < 4; k++) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(c + 16 * k));
+      word |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(x, v))
+              << (16 * k);
+   }
+   return word;
+#else
+   return board_word_8_scalar(c, WORD_BITS, value);
+#endif
+}
+
+/** @brief Zwraca maskę @ref WORD_BITS pól dwubajtowych o wartości
+ * @p value. Wyniki porównań ośmiu pól są pakowane do bajtów, aby jedna
+ * instrukcja zebrała bity szesnastu pól.
+ * @param[in] c       - pierwsze pole,
+ * @param[in] value   - szukana wartość.
+ * @return Zwraca maskę, w której bit k opisuje pole c[k].
+ */
+static inline uint64_t board_word_16(const uint16_t *c, uint32_t value) {
+#if defined(__SSE2__)
+   __m128i v = _mm_set1_epi16((short)value);
+   uint64_t word = 0;
+   for (int k = 0; k < 4; k++) {
+      __m128i a = _mm_loadu_si128((const __m128i *)(c + 16 * k));
+      __m128i b = _mm_loadu_si128((const __m128i *)(c + 16 * k + 8));
+      __m128i x = _mm_packs_epi16(_mm_cmpeq_epi16(a, v), _mm_cmpeq_epi16(b, v));
+      word |= (uint64_t)(uint16_t)_mm_movemask_epi8(x) << (16 * k);
+   }
+   return word;
+#else
+   return board_word_16_scalar(c, WORD_BITS, value);
+#endif
+}
+
+/** @brief Zwraca maskę @ref WORD_BITS pól czterobajtowych o wartości
+ * @p value.
+ * @param[in] c       - pierwsze pole,
+ * @param[in] value   - szukana wartość.
+ * @return Zwraca maskę, w której bit k opisuje pole c[k].
+ */
+static inline uint64_t board_word_32(const uint32_t *c, uint32_t value) {
+#if defined(__SSE2__)
+   __m128i v = _mm_set1_epi32((int)value);
+   uint64_t word = 0;
+   for (int k = 0; k < 16; k++) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(c + 4 * k));
+      word |= (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(
+                 _mm_cmpeq_epi32(x, v))) << (4 * k);
+   }
+   return word;
+#else
+   return board_word_32_scalar(c, WORD_BITS, value);
+#endif
+}
+
+/**
+ * Generuje funkcję board_mask_<bits> wypełniającą maskę pól typu @p type.
+ * Pełne słowa maski liczy funkcja board_word_<bits>, a ostatnie, niepełne
+ * słowo jej wersja skalarna.
+ */
+#define BOARD_MASK(type, bits)                                                \
+static void board_mask_##bits(const type *c, uint64_t count, uint32_t value,  \
+                              uint64_t *mask) {                               \
+   uint64_t i = 0;                                                            \
+   for (; count - i >= WORD_BITS; i += WORD_BITS)                             \
+      mask[i / WORD_BITS] = board_word_##bits(c + i, value);                  \
+   if (i < count)                                                             \
+      mask[i / WORD_BITS] = board_word_##bits##_scalar(c + i, count - i,      \
+                                                       value);                \
+}
+
+BOARD_MASK(uint8_t, 8)
+BOARD_MASK(uint16_t, 16)
+BOARD_MASK(uint32_t, 32)
+
+uint8_t board_cell_bytes(uint32_t players) {
+   // Wartość ramki musi być większa od numeru każdego gracza.
+   if (players < UINT8_MAX)
+      return 1;
+   else if (players < UINT16_MAX)
+      return 2;
+   else
+      return 4;
+}
+
+void board_init(board_t *b, void *cells, uint32_t players) {
+   b->bytes = board_cell_bytes(players);
+   if (b->bytes == 1)
+      b->border = UINT8_MAX;
+   else if (b->bytes == 2)
+      b->border = UINT16_MAX;
+   else
+      b->border = UINT32_MAX;
+
+   b->cells = cells;
+   sparse_init(&b->map);
+   layout_init(&b->layout, 1, 1);
+}
+
+void board_init_sparse(board_t *b, const layout_t *l) {
+   // Pola planszy rzadkiej są zapisywane jako liczby uint32_t.
+   b->bytes = 0;
+   b->border = UINT32_MAX;
+   b->cells = NULL;
+   sparse_init(&b->map);
+   b->layout = *l;
+}
+
+void board_free(board_t *b) {
+   sparse_free(&b->map);
+}
+
+bool board_reserve(board_t *b, uint64_t count) {
+   return b->bytes != 0 || sparse_reserve(&b->map, count);
+}
+
+uint32_t board_sparse_get(const board_t *b, uint64_t num) {
+   const uint32_t *slot = sparse_slot(&b->map, num);
+   if (slot != NULL)
+      return *slot;
+   // Pola ramki nie są przechowywane, rozpoznajemy je po numerze.
+   uint64_t column, row;
+   layout_coords(&b->layout, num, &column, &row);
+   if (row == 0 || row == b->layout.rows - 1 || column == 0 ||
+       column == b->layout.columns - 1)
+      return b->border;
+   return 0;
+}
+
+void board_sparse_set(board_t *b, uint64_t num, uint32_t val) {
+   // Miejsce na nowe pole zapewnia wcześniejsze wywołanie board_reserve,
+   // więc wstawienie się udaje.
+   sparse_put(&b->map, num, val);
+}
+
+void board_mask(const board_t *b, uint64_t num, uint64_t count,
+                uint32_t value, uint64_t *mask) {
+   switch (b->bytes) {
+      case 0:
+         for (uint64_t i = 0; i < count; i += WORD_BITS) {
+            uint64_t word = 0;
+            for (uint64_t k = 0; k < WORD_BITS && i + k < count; k++)
+               word |= (uint64_t)(board_sparse_get(b, num + i + k) == value)
+                       << k;
+            mask[i / WORD_BITS] = word;
+         }
+         break;
+      case 1:
+         board_mask_8((const uint8_t *)b->cells + num, count, value, mask);
+         break;
+      case 2:
+         board_mask_16((const uint16_t *)b->cells + num, count, value, mask);
+         break;
+      default:
+         board_mask_32((const uint32_t *)b->cells + num, count, value, mask);
+         break;
+   }
+}
@@ -0,0 +1,242 @@
+/** @file
+ * Interfejs planszy przechowującej właścicieli pól.
+ *
+ * Szerokość pola planszy (1, 2 lub 4 bajty) jest dobierana do liczby graczy,
+ * dzięki czemu w typowych grach plansza zajmuje czterokrotnie mniej pamięci
+ * i większa jej część mieści się w pamięci podręcznej. Funkcje czytające
+ * sąsiadów pola są generowane osobno dla każdej szerokości, więc wybór
+ * wersji odbywa się raz na pole, a nie raz na sąsiada.
+ *
+ * Rzadka plansza, o szerokości pola 0, przechowuje tylko zajęte pola
+ * w tablicy haszującej, a wartość ramki wyznacza z numeru pola.
+ *
+ * @author Jakub Bedełek
+ */
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "layout.h"
+#include "sparse.h"
+
+/**
+ * Liczba sąsiadów pola planszy.
+ */
+#define BOARD_NEIGHBOURS LAYOUT_NEIGHBOURS
+
+/**
+ * Struktura przechowująca planszę.
+ */
+typedef struct board_s board_t;
+
+/**
+ * Struktura przechowująca planszę.
+ */
+struct board_s {
+   void *cells;                /**< Tablica pól o szerokości bytes bajtów. */
+   uint32_t border;            /**< Największa wartość pola, używana jako
+                                    wartość pól ramki. */
+   uint8_t bytes;              /**< Szerokość pola w bajtach lub 0 dla
+                                    planszy rzadkiej. */
+   sparse_t map;               /**< Pola planszy rzadkiej. */
+   layout_t layout;            /**< Rozmieszczenie pól planszy rzadkiej. */
+};
+
+/** @brief Zwraca szerokość pola planszy dla @p players graczy.
+ * Jest to najwęższy typ pola, w którym mieszczą się numery graczy
+ * od 1 do @p players i wartość ramki większa od każdego z nich.
+ * @param[in] players - liczba graczy, liczba dodatnia mniejsza od
+ *                      UINT32_MAX.
+ * @return Zwraca szerokość pola w bajtach: 1, 2 lub 4.
+ */
+uint8_t board_cell_bytes(uint32_t players);
+
+/** @brief Tworzy planszę w obszarze pamięci @p cells. Nie zmienia
+ * zawartości obszaru.
+ * @param[out] b      - wskaźnik na planszę,
+ * @param[in] cells   - obszar pamięci na pola o szerokości
+ *                      @ref board_cell_bytes(@p players) bajtów,
+ * @param[in] players - liczba graczy, liczba dodatnia mniejsza od
+ *                      UINT32_MAX.
+ */
+void board_init(board_t *b, void *cells, uint32_t players);
+
+/** @brief Tworzy rzadką planszę o rozmieszczeniu pól @p l, otoczoną ramką
+ * szerokości jednego pola, bez alokowania pamięci.
+ * @param[out] b      - wskaźnik na planszę,
+ * @param[in] l       - wskaźnik na rozmieszczenie pól razem z ramką.
+ */
+void board_init_sparse(board_t *b, const layout_t *l);
+
+/** @brief Zwalnia pamięć rzadkiej planszy. Nic nie robi dla planszy
+ * przechowywanej w tablicy.
+ * @param[in,out] b   - wskaźnik na planszę.
+ */
+void board_free(board_t *b);
+
+/** @brief Zapewnia miejsce na @p count nowych pól rzadkiej planszy, tak aby
+ * kolejne wywołania @ref board_set nie musiały alokować pamięci.
+ * @param[in,out] b   - wskaźnik na planszę,
+ * @param[in] count   - liczba pól.
+ * @return Zwraca true jeśli jest miejsce na pola lub false, jeśli nie udało
+ * się zaalokować pamięci.
+ */
+bool board_reserve(board_t *b, uint64_t count);
+
+/** @brief Zwraca wartość pola o numerze @p num rzadkiej planszy.
+ * @param[in] b       - wskaźnik na rzadką planszę,
+ * @param[in] num     - numer pola.
+ * @return Zwraca wartość pola o numerze @p num.
+ */
+uint32_t board_sparse_get(const board_t *b, uint64_t num);
+
+/** @brief Ustawia wartość pola o numerze @p num rzadkiej planszy. Nowe pole
+ * musi mieć miejsce zapewnione funkcją @ref board_reserve.
+ * @param[in,out] b   - wskaźnik na rzadką planszę,
+ * @param[in] num     - numer pola spoza ramki,
+ * @param[in] val     - nowa wartość pola.
+ */
+void board_sparse_set(board_t *b, uint64_t num, uint32_t val);
+
+/** @brief Zaznacza w masce @p mask pola o wartości @p value spośród
+ * @p count kolejnych pól, zaczynając od pola o numerze @p num.
+ * Pola są porównywane instrukcjami SSE2 lub AVX2, jeśli kompilator na
+ * nie pozwala, i zwykłymi porównaniami w przeciwnym przypadku.
+ * @param[in] b       - wskaźnik na planszę,
+ * @param[in] num     - numer pierwszego pola,
+ * @param[in] count   - liczba pól,
+ * @param[in] value   - szukana wartość,
+ * @param[out] mask   - tablica (@p count + 63) / 64 słów; bit k % 64 słowa
+ *                      k / 64 opisuje pole o numerze @p num + k, a bity
+ *                      za ostatnim polem są zerowane.
+ */
+void board_mask(const board_t *b, uint64_t num, uint64_t count,
+                uint32_t value, uint64_t *mask);
+
+/** @brief Zwraca wartość pola o numerze @p num.
+ * @param[in] b       - wskaźnik na planszę,
+ * @param[in] num     - numer pola.
+ * @return Zwraca wartość pola o numerze @p num.
+ */
+static inline uint32_t board_get(const board_t *b, uint64_t num) {
+   switch (b->bytes) {
+      case 0:
+         return board_sparse_get(b, num);
+      case 1:
+         return ((const uint8_t *)b->cells)[num];
+      case 2:
+         return ((const uint16_t *)b->cells)[num];
+      default:
+         return ((const uint32_t *)b->cells)[num];
+   }
+}
+
+/** @brief Ustawia wartość pola o numerze @p num.
+ * @param[in,out] b   - wskaźnik na planszę,
+ * @param[in] num     - numer pola,
+ * @param[in] val     - nowa wartość pola, niewiększa od b->border.
+ */
+static inline void board_set(board_t *b, uint64_t num, uint32_t val) {
+   switch (b->bytes) {
+      case 0:
+         board_sparse_set(b, num, val);
+         break;
+      case 1:
+         ((uint8_t *)b->cells)[num] = (uint8_t)val;
+         break;
+      case 2:
+         ((uint16_t *)b->cells)[num] = (uint16_t)val;
+         break;
+      default:
+         ((uint32_t *)b->cells)[num] = val;
+         break;
+   }
+}
+
+/** @brief Zwraca adres pola o numerze @p num.
+ * @param[in] b       - wskaźnik na planszę,
+ * @param[in] num     - numer pola.
+ * @return Zwraca adres pierwszego z b->bytes bajtów pola lub NULL dla
+ * rzadkiej planszy.
+ */
+static inline void *board_addr(const board_t *b, uint64_t num) {
+   return b->bytes == 0 ? NULL : (char *)b->cells + num * b->bytes;
+}
+
+/**
+ * Generuje funkcje czytające sąsiadów pola dla pól typu @p type:
+ * board_count_<bits> liczącą sąsiadów o wartości player i board_owners_<bits>
+ * zapisującą wartości wszystkich sąsiadów.
+ */
+#define BOARD_KERNELS(type, bits)                                             \
+static inline uint32_t board_count_##bits(const type *c, const layout_t *l,   \
+                                          uint64_t num, uint32_t player) {    \
+   return (uint32_t)(c[layout_step(l, num, 0)] == player) +                   \
+          (uint32_t)(c[layout_step(l, num, 1)] == player) +                   \
+          (uint32_t)(c[layout_step(l, num, 2)] == player) +                   \
+          (uint32_t)(c[layout_step(l, num, 3)] == player);                    \
+}                                                                             \
+static inline void board_owners_##bits(const type *c, const layout_t *l,      \
+                                       uint64_t num, uint32_t *owner) {       \
+   for (int i = 0; i < BOARD_NEIGHBOURS; i++)                                 \
+      owner[i] = c[layout_step(l, num, i)];                                   \
+}
+
+BOARD_KERNELS(uint8_t, 8)
+BOARD_KERNELS(uint16_t, 16)
+BOARD_KERNELS(uint32_t, 32)
+
+/** @brief Liczy sąsiadów pola o numerze @p num o wartości @p player.
+ * @param[in] b       - wskaźnik na planszę,
+ * @param[in] l       - wskaźnik na rozmieszczenie pól planszy,
+ * @param[in] num     - numer pola, którego wszyscy sąsiedzi leżą na planszy,
+ * @param[in] player  - szukana wartość.
+ * @return Zwraca liczbę sąsiadów o wartości @p player.
+ */
+static inline uint32_t board_count(const board_t *b, const layout_t *l,
+                                   uint64_t num, uint32_t player) {
+   uint32_t count = 0;
+   switch (b->bytes) {
+      case 0:
+         for (int i = 0; i < BOARD_NEIGHBOURS; i++)
+            count += (uint32_t)(board_sparse_get(b, layout_step(l, num, i)) ==
+                                player);
+         return count;
+      case 1:
+         return board_count_8(b->cells, l, num, player);
+      case 2:
+         return board_count_16(b->cells, l, num, player);
+      default:
+         return board_count_32(b->cells, l, num, player);
+   }
+}
+
+/** @brief Zapisuje wartości sąsiadów pola o numerze @p num.
+ * @param[in] b       - wskaźnik na planszę,
+ * @param[in] l       - wskaźnik na rozmieszczenie pól planszy,
+ * @param[in] num     - numer pola, którego wszyscy sąsiedzi leżą na planszy,
+ * @param[out] owner  - tablica na wartości czterech sąsiadów.
+ */
+static inline void board_owners(const board_t *b, const layout_t *l,
+                                uint64_t num, uint32_t *owner) {
+   switch (b->bytes) {
+      case 0:
+         for (int i = 0; i < BOARD_NEIGHBOURS; i++)
+            owner[i] = board_sparse_get(b, layout_step(l, num, i));
+         break;
+      case 1:
+         board_owners_8(b->cells, l, num, owner);
+         break;
+      case 2:
+         board_owners_16(b->cells, l, num, owner);
+         break;
+      default:
+         board_owners_32(b->cells, l, num, owner);
+         break;
+   }
+}
+
+#endif /* BOARD_H */
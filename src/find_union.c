@@ -6,94 +6,753 @@
  */
  
 #include "find_union.h"
+#include "snapshot.h"
 #include <stdlib.h>
+#include <string.h>
+
+/**
+ * Minimalna liczba dodatkowych węzłów, poza węzłami pól.
+ */
+#define SPARE_NODES 8
+
+/**
+ * Pojemność tablicy haszującej odwiedzonych pól rzadkiej planszy, do której
+ * tablica jest czyszczona zamiast zwalniania.
+ */
+#define VISITS_MIN_CAPACITY 64
 
 /**
  * Struktura przechowywująca tablice o rozmiarze liczba pól gry. 
  */
 typedef struct array_f array_t;
 
+/**
+ * Struktura opisująca jedno przeszukiwanie wszerz obszaru.
+ */
+typedef struct search_f search_t;
+
 /**
  * Struktura przechowująca dane potrzebne do wykonania algorytmu find_union.
  */
 struct find_s {
    array_t *arrays;             /**< Struktura przechowywująca tablice o rozmiarze
-                                     liczba pól gry. */
+                                     liczba węzłów. */
+   uint32_t *node;              /**< Tablica przyporządkowująca każdemu polu
+                                     jego węzeł, zapisany jako różnica
+                                     numerów węzła i pola, lub NULL, jeśli
+                                     węzły pól są w tablicy haszującej
+                                     nodes. */
+   sparse_t nodes;              /**< Węzły zajętych pól rzadkiej planszy. */
+   uint64_t size;               /**< Liczba pól. */
+   uint64_t capacity;           /**< Liczba węzłów. */
+   uint64_t next;               /**< Numer pierwszego wolnego węzła. */
+   uint64_t *visited;           /**< Mapy bitowe pól odwiedzonych przez
+                                     przeszukiwania, po jednej na
+                                     przeszukiwanie, ze słowami opisującymi
+                                     te same 64 pola obok siebie, alokowane
+                                     przy pierwszym rozpadzie obszaru,
+                                     lub NULL. */
+   sparse_t visits;             /**< Numery przeszukiwań pól rzadkiej
+                                     planszy. */
+   search_t *search;            /**< Przeszukiwania ostatniego rozpadu
+                                     obszaru, po jednym z każdego sąsiada
+                                     usuwanego pola. */
+   uint32_t searches;           /**< Liczba przeszukiwań ostatniego rozpadu
+                                     obszaru. */
+   journal_t *journal;          /**< Dziennik zmian lub NULL, jeśli ruchów
+                                     nie można cofać. */
+};
+
+/**
+ * Struktura opisująca jedno przeszukiwanie wszerz obszaru. Kolejka
+ * zachowuje wszystkie odwiedzone pola, więc po przeszukaniu są to pola
+ * z przedziału [0, tail).
+ */
+struct search_f {
+   uint64_t *queue;            /**< Kolejka odwiedzonych pól. */
+   uint64_t head;              /**< Numer następnego pola do rozwinięcia. */
+   uint64_t tail;              /**< Liczba pól w kolejce. */
+   uint64_t size;              /**< Pojemność kolejki. */
+   uint32_t group;             /**< Przeszukiwanie, z którym się spotkało,
+                                    lub numer tego przeszukiwania. */
 };
 
 /**
  * Struktura przechowywująca tablice o rozmiarze liczba pól gry. 
+ * Reprezentant i wielkość węzła leżą obok siebie, bo łączenie obszarów
+ * czyta oba dla każdego korzenia. Obie wartości są zapisane tak, aby
+ * zera opisywały węzeł będący osobnym obszarem wielkości 1, więc tablice
+ * wypełnione zerami nie wymagają inicjalizacji.
  */
 struct array_f {
-   uint32_t rep;               /**< Tablica przyporządkowująca każdemu polu 
-                                     reprezentanta. */
+   uint32_t rep;               /**< Tablica przyporządkowująca każdemu węzłowi
+                                     reprezentanta, zapisanego jako różnica
+                                     numerów reprezentanta i węzła. */
    uint32_t rank;              /**< Tablica przyporządkowującaa każdemu
-                                     polu wielkość obszaru, do którego należy.*/
+                                     węzłowi wielkość obszaru, do którego
+                                     należy, pomniejszoną o 1. */
 };
 
-void init(find_t *f, uint32_t width, uint32_t height) {
-   f->arrays = calloc((uint64_t)width * (uint64_t)height, sizeof(array_t));
+/** @brief Zwraca reprezentanta węzła @p number.
+ * @param[in] f       - wskaźnik na strukturę przechowującą dane,
+ * @param[in] number  - numer węzła.
+ * @return Zwraca numer reprezentanta.
+ */
+static inline uint32_t get_rep(const find_t *f, uint32_t number) {
+   return number + f->arrays[number].rep;
+}
+
+/** @brief Ustawia reprezentanta węzła @p number.
+ * @param[in,out] f   - wskaźnik na strukturę przechowującą dane,
+ * @param[in] number  - numer węzła,
+ * @param[in] rep     - numer reprezentanta.
+ */
+static inline void set_rep(find_t *f, uint32_t number, uint32_t rep) {
+   f->arrays[number].rep = rep - number;
+}
+
+/** @brief Zwraca wielkość obszaru węzła @p number.
+ * @param[in] f       - wskaźnik na strukturę przechowującą dane,
+ * @param[in] number  - numer węzła.
+ * @return Zwraca wielkość obszaru.
+ */
+static inline uint32_t get_rank(const find_t *f, uint32_t number) {
+   return f->arrays[number].rank + 1;
+}
+
+/** @brief Ustawia wielkość obszaru węzła @p number.
+ * @param[in,out] f   - wskaźnik na strukturę przechowującą dane,
+ * @param[in] number  - numer węzła,
+ * @param[in] rank    - wielkość obszaru, liczba dodatnia.
+ */
+static inline void set_rank(find_t *f, uint32_t number, uint32_t rank) {
+   f->arrays[number].rank = rank - 1;
+}
+
+/** @brief Zwraca liczbę węzłów struktury dla @p size pól.
+ * Dodatkowe węzły są zużywane przez rozpadające się obszary.
+ * @param[in] size    – liczba pól.
+ * @return Zwraca liczbę węzłów.
+ */
+static uint64_t capacity(uint64_t size) {
+   return size + size / 8 + SPARE_NODES;
+}
+
+uint64_t find_bytes(uint64_t size, bool sparse) {
+   // Tablice struktury dla rzadkiej planszy są alokowane osobno.
+   if (sparse)
+      return arena_align(sizeof(find_t)) +
+             arena_align(BOARD_NEIGHBOURS * sizeof(search_t));
+   return arena_align(sizeof(find_t)) +
+          arena_align(capacity(size) * sizeof(array_t)) +
+          arena_align(size * sizeof(uint32_t)) +
+          arena_align(BOARD_NEIGHBOURS * sizeof(search_t));
+}
+
+find_t *new_find_t(void *mem, uint64_t size, bool sparse) {
+   char *next = mem;
+   find_t *f = arena_take(&next, sizeof(find_t));
+
+   f->size = size;
+   sparse_init(&f->nodes);
+   sparse_init(&f->visits);
+   f->visited = NULL;
+   if (sparse) {
+      f->capacity = f->next = 0;
+      f->arrays = NULL;
+      f->node = NULL;
+   }
+   else {
+      // Wyzerowane tablice opisują pola będące osobnymi obszarami.
+      f->capacity = capacity(size);
+      f->next = size;
+      f->arrays = arena_take(&next, f->capacity * sizeof(array_t));
+      f->node = arena_take(&next, size * sizeof(uint32_t));
+   }
+   f->search = arena_take(&next, BOARD_NEIGHBOURS * sizeof(search_t));
+   memset(f->search, 0, BOARD_NEIGHBOURS * sizeof(search_t));
+   f->searches = 0;
+   f->journal = NULL;
+   return f;
+}
+
+bool copy_find(find_t *dst, const find_t *src) {
+   // Tablica visited i kolejki przeszukiwań są pomocnicze, struktura dst
+   // zachowuje swoje razem z licznikiem przeszukiwań.
+   if (src->node == NULL) {
+      if (dst->capacity < src->next) {
+         array_t *arrays = realloc(dst->arrays, src->next * sizeof(array_t));
+         if (arrays == NULL)
+            return false;
+         dst->arrays = arrays;
+         dst->capacity = src->next;
+      }
+      if (!sparse_copy(&dst->nodes, &src->nodes))
+         return false;
+   }
+   else {
+      memcpy(dst->node, src->node, src->size * sizeof(uint32_t));
+   }
+   if (src->next > 0)
+      memcpy(dst->arrays, src->arrays, src->next * sizeof(array_t));
+   dst->next = src->next;
+   dst->searches = 0;
+   return true;
+}
+
+bool save_find(const find_t *f, int fd) {
+   // Tablica arrays składa się z par liczb uint32_t: rep i rank.
+   return snapshot_write(fd, &f->next, 1, sizeof(uint64_t)) &&
+          snapshot_write(fd, f->node, f->size, sizeof(uint32_t)) &&
+          snapshot_write(fd, f->arrays, 2 * f->next, sizeof(uint32_t));
+}
+
+bool load_find(find_t *f, int fd) {
+   if (!snapshot_read(fd, &f->next, 1, sizeof(uint64_t)) ||
+       f->next < f->size || f->next > f->capacity ||
+       !snapshot_read(fd, f->node, f->size, sizeof(uint32_t)) ||
+       !snapshot_read(fd, f->arrays, 2 * f->next, sizeof(uint32_t)))
+      return false;
+
+   // Odczytane numery węzłów muszą wskazywać na używane węzły.
+   for (uint64_t i = 0; i < f->size; i++) {
+      if ((uint32_t)i + f->node[i] >= f->next)
+         return false;
+   }
+   // Węzeł dołączany do drzewa ma mniejszą wielkość niż korzeń, do którego
+   // go dołączamy, a potem jego wielkość się nie zmienia, więc wielkości
+   // rosną na ścieżce do korzenia i drzewa nie mają cykli.
+   for (uint64_t i = 0; i < f->next; i++) {
+      uint32_t rep = get_rep(f, i);
+      if (rep >= f->next || (rep != i && get_rank(f, rep) <= get_rank(f, i)))
+         return false;
+   }
+   f->searches = 0;
+   return true;
 }
 
 void delete_funion(find_t *f) {
-    free(f->arrays);
+   // Poza obszarem pamięci struktury są kolejki przeszukiwań i tablice
+   // struktury dla rzadkiej planszy.
+   for (int i = 0; i < BOARD_NEIGHBOURS; i++)
+      free(f->search[i].queue);
+   if (f->node == NULL)
+      free(f->arrays);
+   free(f->visited);
+   sparse_free(&f->nodes);
+   sparse_free(&f->visits);
+}
+
+void fill_find(find_t *f, uint64_t size) {
+   // Pola rzadkiej planszy dostają węzły dopiero po zajęciu.
+   if (f->node == NULL) {
+      sparse_clear(&f->nodes);
+      f->next = 0;
+      f->searches = 0;
+      return;
+   }
+   memset(f->arrays, 0, size * sizeof(array_t));
+   memset(f->node, 0, size * sizeof(uint32_t));
+   f->next = size;
 }
 
-void fill_find(find_t *f, uint32_t width, uint32_t height) {
-   for (uint32_t i = 0; i < width * height; i ++) {
-      f->arrays[i].rank = 1;
-      f->arrays[i].rep = i; 
+void reset_find(find_t *f, const uint64_t *cells, uint64_t count) {
+   if (f->node == NULL) {
+      fill_find(f, f->size);
+      return;
    }
+   for (uint64_t i = 0; i < count; i++) {
+      uint64_t number = cells[i];
+      f->arrays[number].rank = f->arrays[number].rep = 0;
+      f->node[number] = 0;
+   }
+   // Węzły spoza pól należały tylko do pól z tablicy cells.
+   f->next = f->size;
+   f->searches = 0;
+}
+
+void find_journal(find_t *f, journal_t *journal) {
+   f->journal = journal;
 }
 
-bool check_alloc_find(find_t *f) {
-   return (f->arrays == NULL);
+/** @brief Zapisuje w dzienniku poprzednią zawartość pola, jeśli ruchy
+ * można cofać.
+ * @param[in] f       - wskaźnik na strukturę przechowującą dane,
+ * @param[in] addr    - adres zmienianego pola,
+ * @param[in] bytes   - wielkość pola w bajtach.
+ */
+static void save(find_t *f, void *addr, uint32_t bytes) {
+   if (f->journal != NULL)
+      journal_save(f->journal, addr, bytes);
 }
 
-void increase_rank(find_t *f, uint32_t rep_number) {
-   f->arrays[rep_number].rank++;
+/** @brief Sprawdza, czy zostało co najmniej @p count wolnych węzłów.
+ * @param[in] f       - wskaźnik na strukturę przechowującą dane,
+ * @param[in] count   - liczba potrzebnych węzłów.
+ * @return Zwraca true jeśli funkcja @ref new_area może zostać wywołana
+ * @p count razy lub false w przeciwnym przypadku.
+ */
+static bool check_spare(find_t *f, uint32_t count) {
+   return f->capacity - f->next >= count;
 }
 
+/** @brief Tworzy nowy obszar o wielkości @p rank.
+ * Obszar nie zawiera jeszcze żadnego pola, pola przypisuje się do niego
+ * funkcją @ref set_area.
+ * @param[in] f       - wskaźnik na strukturę przechowującą dane,
+ * @param[in] rank    - wielkość obszaru.
+ * @return Zwraca reprezentanta nowego obszaru.
+ */
+static uint32_t new_area(find_t *f, uint32_t rank) {
+   // Węzły od numeru next są nieużywane, wystarczy zapisać sam licznik.
+   save(f, &f->next, sizeof(f->next));
+   uint32_t number = f->next++;
+   set_rep(f, number, number);
+   set_rank(f, number, rank);
+   return number;
+}
 
-uint32_t find(uint32_t number1, find_t *f) {
-   if (f->arrays[number1].rep != number1) 
-      f->arrays[number1].rep = find(f->arrays[number1].rep, f); 
-   
-   return f->arrays[number1].rep; 
+/** @brief Powiększa tablicę węzłów struktury dla rzadkiej planszy tak, aby
+ * zostało co najmniej @p count wolnych węzłów.
+ * @param[in] f       - wskaźnik na strukturę przechowującą dane,
+ * @param[in] count   - liczba potrzebnych węzłów.
+ * @return Zwraca true jeśli udało się powiększyć tablicę lub false, jeśli
+ * tablica leży w obszarze pamięci struktury, liczba węzłów przekroczyłaby
+ * zakres typu uint32_t lub nie udało się zaalokować pamięci.
+ */
+static bool grow_nodes(find_t *f, uint32_t count) {
+   if (f->node != NULL)
+      return false;
+   uint64_t new_capacity = 2 * f->capacity;
+   if (new_capacity < f->next + count + SPARE_NODES)
+      new_capacity = f->next + count + SPARE_NODES;
+   if (new_capacity > UINT32_MAX)
+      new_capacity = UINT32_MAX;
+   if (new_capacity - f->next < count)
+      return false;
+   array_t *arrays = realloc(f->arrays, new_capacity * sizeof(array_t));
+   if (arrays == NULL)
+      return false;
+   f->arrays = arrays;
+   f->capacity = new_capacity;
+   return true;
+}
+
+/** @brief Zwraca węzeł pola o numerze @p number.
+ * Zajęte pole rzadkiej planszy, które nie ma jeszcze węzła, dostaje nowy
+ * węzeł. Miejsce na niego zapewnia wcześniejsze wywołanie
+ * @ref find_reserve.
+ * @param[in] f       - wskaźnik na strukturę przechowującą dane,
+ * @param[in] number  - numer pola.
+ * @return Zwraca węzeł pola.
+ */
+static uint32_t get_node(find_t *f, uint64_t number) {
+   if (f->node != NULL)
+      return (uint32_t)number + f->node[number];
+   const uint32_t *slot = sparse_slot(&f->nodes, number);
+   if (slot != NULL)
+      return *slot;
+   uint32_t node = new_area(f, 1);
+   sparse_put(&f->nodes, number, node);
+   return node;
+}
+
+bool find_reserve(find_t *f, uint32_t cells) {
+   return f->node != NULL ||
+          (sparse_reserve(&f->nodes, cells) &&
+           (check_spare(f, cells) || grow_nodes(f, cells)));
+}
+
+/** @brief Zwraca korzeń drzewa zawierającego węzeł @p number1.
+ * Skraca ścieżkę przez połowienie: każdy odwiedzony węzeł zaczyna wskazywać
+ * na swojego dziadka, więc jedno przejście bez rekurencji skraca ścieżkę
+ * o połowę. Gdy ruchy można cofać, ścieżka nie jest skracana, bo każda
+ * zmiana musiałaby trafić do dziennika, a łączenie według wielkości
+ * i tak ogranicza wysokość drzew do logarytmu liczby pól.
+ * @param[in] number1   - numer węzła,
+ * @param[in] f         – wskaźnik na strukturę przechowującą dane,
+ * @return Zwraca korzeń drzewa zawierającego węzeł @p number1.
+ */
+static uint32_t find_node(uint32_t number1, find_t *f) {
+   // Korzeń ma zerową różnicę numerów reprezentanta i węzła.
+   if (f->journal != NULL) {
+      while (f->arrays[number1].rep != 0)
+         number1 = get_rep(f, number1);
+      return number1;
+   }
+   while (f->arrays[number1].rep != 0) {
+      set_rep(f, number1, get_rep(f, get_rep(f, number1)));
+      number1 = get_rep(f, number1);
+   }
+   return number1;
 }
 
+uint32_t find(uint64_t number1, find_t *f) {
+   return find_node(get_node(f, number1), f);
+}
 
-void funion(find_t *f, uint32_t number1, uint32_t val) {
-   // Szukamy reprezentantów parametrów number1 i val. 
-   uint32_t f1 = find(number1, f); 
-   uint32_t f2 = find(val, f); 
    
-   // Łączymy obaszary zawierające pola o numerze number1 i val w jeden obszar. 
-   if (f->arrays[f1].rank >= f->arrays[f2].rank) {
-      f->arrays[f1].rank += f->arrays[f2].rank; 
-      f->arrays[f2].rep = f1;  
+uint32_t funion(find_t *f, uint32_t f1, uint32_t f2) {
+   // Łączymy obaszary o reprezentantach f1 i f2 w jeden obszar.
+   if (f1 == f2)
+      return f1;
+   save(f, &f->arrays[f1], sizeof(array_t));
+   save(f, &f->arrays[f2], sizeof(array_t));
+   uint32_t rank1 = get_rank(f, f1), rank2 = get_rank(f, f2);
+   if (rank1 >= rank2) {
+      set_rank(f, f1, rank1 + rank2);
+      set_rep(f, f2, f1);
+      return f1;
    }
    else {
-      f->arrays[f2].rank += f->arrays[f1].rank; 
-      f->arrays[f1].rep = f2;  
+      set_rank(f, f2, rank1 + rank2);
+      set_rep(f, f1, f2);
+      return f2;
    }
 }
 
-void change_rep(find_t *f, uint32_t number1, uint32_t val) {
-   f->arrays[number1].rep = val;
+/** @brief Przenosi pole o numerze @p number1 do obszaru o reprezentancie
+ * @p val.
+ * @param[in] f         - wskaźnik na strukturę przechowującą dane,
+ * @param[in] number1   - numer pola,
+ * @param[in] val       - reprezentant obszaru utworzonego przez
+ *                        @ref new_area.
+ */
+static void set_area(find_t *f, uint64_t number1, uint32_t val) {
+   // Pole rzadkiej planszy ma już węzeł, więc wstawienie nie alokuje pamięci.
+   if (f->node == NULL) {
+      sparse_put(&f->nodes, number1, val);
+      return;
+   }
+   save(f, &f->node[number1], sizeof(uint32_t));
+   f->node[number1] = val - (uint32_t)number1;
 }
 
-void change_rank(find_t *f, uint32_t number1, uint32_t val) {
-   f->arrays[number1].rank = val;
+/** @brief Łączy obszar pola o numerze @p number z obszarami sąsiadów
+ * o mniejszych numerach należących do gracza @p owner.
+ * @param[in] f         - wskaźnik na strukturę przechowującą dane,
+ * @param[in] board     - plansza,
+ * @param[in] l         - rozmieszczenie pól planszy,
+ * @param[in] number    - numer pola spoza ramki,
+ * @param[in] owner     - właściciel pola.
+ */
+static void link_cell(find_t *f, const board_t *board, const layout_t *l,
+                      uint64_t number, uint32_t owner) {
+   uint32_t f1 = find(number, f);
+   // Wystarczy łączyć z sąsiadami o mniejszych numerach, czyli lewym
+   // i dolnym, przy każdym rozmieszczeniu pól.
+   for (int k = 0; k < 2; k++) {
+      uint64_t number2 = layout_step(l, number, k);
+      if (board_get(board, number2) != owner)
+         continue;
+      uint32_t f2 = find(number2, f);
+      if (f1 != f2)
+         f1 = funion(f, f1, f2);
+   }
 }
 
-find_t* new_find_t() {
-   return malloc(sizeof(find_t));
+void rebuild_find(find_t *f, const board_t *board, const layout_t *l) {
+   // Przebudowy nie da się cofnąć, więc dziennik zapomina wcześniejsze ruchy.
+   journal_t *journal = f->journal;
+   f->journal = NULL;
+   if (journal != NULL)
+      journal_clear(journal);
+   fill_find(f, f->size);
+
+   if (f->node == NULL) {
+      // Zajęte pola rzadkiej planszy miały węzły przed przebudową, więc
+      // ich nowe węzły mieszczą się w tablicach.
+      uint64_t pos = 0, number;
+      uint32_t owner;
+      while (sparse_next(&board->map, &pos, &number, &owner)) {
+         if (owner != 0)
+            link_cell(f, board, l, number, owner);
+      }
+   }
+   else {
+      for (uint64_t i = 0; i < f->size; i++) {
+         uint32_t owner = board_get(board, i);
+         if (owner != 0 && owner != board->border)
+            link_cell(f, board, l, i, owner);
+      }
+   }
+   f->journal = journal;
+}
+
+/** @brief Wkłada pole o numerze @p number na koniec kolejki przeszukiwania
+ * @p s. Kolejka jest powiększana co najmniej dwukrotnie i nie jest zwalniana
+ * między rozpadami obszarów, więc kolejne rozpady w większości nie
+ * alokują pamięci.
+ * @param[in,out] s   – wskaźnik na przeszukiwanie,
+ * @param[in] number  – numer pola planszy.
+ * @return Zwraca true jeśli pole zostało włożone do kolejki lub false jeśli
+ * nie udało się zaalokować pamięci.
+ */
+static bool push_search(search_t *s, uint64_t number) {
+   if (s->tail == s->size) {
+      uint64_t new_size = s->size < 16 ? 16 : 2 * s->size;
+      uint64_t *queue = realloc(s->queue, new_size * sizeof(uint64_t));
+      if (queue == NULL)
+         return false;
+      s->queue = queue;
+      s->size = new_size;
+   }
+   s->queue[s->tail++] = number;
+   return true;
 }
 
-void delete_funion_all(find_t *f) {
-    if (f != NULL) {
-       if (f->arrays != NULL) 
-          free(f->arrays);
-    }
+/** @brief Zwraca numer przeszukiwania, które odwiedziło pole @p number.
+ * @param[in] f       - wskaźnik na strukturę przechowującą dane,
+ * @param[in] number  – numer pola planszy.
+ * @return Zwraca numer przeszukiwania powiększony o 1 lub 0, jeśli pole
+ * nie zostało odwiedzone w bieżącym rozpadzie obszaru.
+ */
+static uint32_t get_visited(const find_t *f, uint64_t number) {
+   if (f->node == NULL) {
+      const uint32_t *slot = sparse_slot(&f->visits, number);
+      return slot == NULL ? 0 : *slot;
+   }
+   // Pole odwiedza co najwyżej jedno przeszukiwanie.
+   const uint64_t *word = f->visited + number / 64 * BOARD_NEIGHBOURS;
+   uint64_t bit = (uint64_t)1 << (number % 64);
+   for (uint32_t i = 0; i < f->searches; i++) {
+      if (word[i] & bit)
+         return i + 1;
+   }
+   return 0;
+}
+
+/** @brief Oznacza pole o numerze @p number jako odwiedzone przez
+ * przeszukiwanie o numerze @p value - 1.
+ * @param[in] f       - wskaźnik na strukturę przechowującą dane,
+ * @param[in] number  – numer pola planszy,
+ * @param[in] value   – numer przeszukiwania powiększony o 1.
+ * @return Zwraca true jeśli udało się oznaczyć pole lub false, jeśli nie
+ * udało się zaalokować pamięci.
+ */
+static bool set_visited(find_t *f, uint64_t number, uint32_t value) {
+   if (f->node == NULL)
+      return sparse_put(&f->visits, number, value);
+   f->visited[number / 64 * BOARD_NEIGHBOURS + value - 1] |=
+      (uint64_t)1 << (number % 64);
+   return true;
+}
+
+/** @brief Usuwa oznaczenia pól odwiedzonych w bieżącym rozpadzie obszaru.
+ * Odwiedzone pola leżą w kolejkach przeszukiwań, więc koszt jest
+ * proporcjonalny do ich liczby, a nie do wielkości planszy.
+ * @param[in,out] f   - wskaźnik na strukturę przechowującą dane.
+ */
+static void clear_visited(find_t *f) {
+   uint64_t touched = 0;
+   for (uint32_t i = 0; i < f->searches; i++) {
+      const search_t *s = &f->search[i];
+      touched += s->tail;
+      if (f->node == NULL)
+         continue;
+      // Wszystkie bity słowa pochodzą z bieżącego rozpadu.
+      for (uint64_t k = 0; k < s->tail; k++)
+         f->visited[s->queue[k] / 64 * BOARD_NEIGHBOURS + i] = 0;
+   }
+   // Tablicę haszującą znacznie większą niż liczba odwiedzonych pól
+   // zwalniamy, aby małe rozpady nie czyściły jej całej.
+   if (f->visits.capacity > 4 * touched + VISITS_MIN_CAPACITY)
+      sparse_free(&f->visits);
+   else
+      sparse_clear(&f->visits);
+}
+
+/** @brief Zwraca numer grupy, do której należy przeszukiwanie @p i.
+ * Przeszukiwania, które się spotkały, przeszukują ten sam obszar i należą
+ * do jednej grupy.
+ * @param[in] f       - wskaźnik na strukturę przechowującą dane,
+ * @param[in] i       – numer przeszukiwania.
+ * @return Zwraca numer grupy przeszukiwania @p i.
+ */
+static uint32_t search_group(const find_t *f, uint32_t i) {
+   while (f->search[i].group != i)
+      i = f->search[i].group;
+   return i;
+}
+
+/** @brief Sprawdza, czy grupa @p i ma jeszcze pola do odwiedzenia.
+ * @param[in] f       - wskaźnik na strukturę przechowującą dane,
+ * @param[in] i       – numer grupy.
+ * @return Zwraca true jeśli któreś przeszukiwanie z grupy @p i ma niepustą
+ * kolejkę.
+ */
+static bool group_active(const find_t *f, uint32_t i) {
+   for (uint32_t j = 0; j < f->searches; j++) {
+      if (search_group(f, j) == i && f->search[j].head < f->search[j].tail)
+         return true;
+   }
+   return false;
+}
+
+/** @brief Liczy części, na które rozpada się obszar pola @p number po
+ * usunięciu tego pola, tak jak opisuje to @ref fsplit. Pole @p number jest
+ * pomijane przez przeszukiwania, więc plansza nie jest zmieniana.
+ * Przeszukiwania i odwiedzone pola zapisuje w strukturze @p f, której
+ * pozostałe pola nie są używane.
+ * @param[in,out] f     - wskaźnik na strukturę z przeszukiwaniami,
+ * @param[in] board     - plansza,
+ * @param[in] l         - rozmieszczenie pól planszy,
+ * @param[in] number    - numer pola,
+ * @param[out] new_areas - liczba części, na które rozpada się obszar.
+ * @return Zwraca true jeśli udało się policzyć części lub false jeśli
+ * nie udało się zaalokować pamięci.
+ */
+static bool split_search(find_t *f, const board_t *board, const layout_t *l,
+                         uint64_t number, uint32_t *new_areas) {
+   uint32_t owner = board_get(board, number);
+   uint32_t owners[BOARD_NEIGHBOURS];
+   // Przeszukiwanie i zaznacza odwiedzone pola wartością i + 1.
+   uint32_t count = 0, active;
+   f->searches = 0;
+
+   board_owners(board, l, number, owners);
+   for (int i = 0; i < BOARD_NEIGHBOURS; i++) {
+      uint64_t number2 = layout_step(l, number, i);
+      if (owners[i] != owner)
+         continue;
+
+      search_t *s = &f->search[count];
+      s->head = s->tail = 0;
+      s->group = count;
+      if (!push_search(s, number2) ||
+          !set_visited(f, number2, count + 1)) {
+         clear_visited(f);
+         return false;
+      }
+      f->searches = ++count;
+   }
+   active = count;
+
+   while (active > 1) {
+      for (uint32_t i = 0; i < count; i++) {
+         search_t *s = &f->search[i];
+         if (s->head == s->tail)
+            continue;
+
+         uint64_t cell = s->queue[s->head++];
+         board_owners(board, l, cell, owners);
+         for (int j = 0; j < BOARD_NEIGHBOURS; j++) {
+            uint64_t number2 = layout_step(l, cell, j);
+            if (owners[j] != owner || number2 == number)
+               continue;
+
+            uint32_t v = get_visited(f, number2);
+            if (v > 0) {
+               // Spotkaliśmy inne przeszukiwanie, łączymy grupy.
+               uint32_t a = search_group(f, i);
+               uint32_t b = search_group(f, v - 1);
+               if (a != b)
+                  f->search[b].group = a;
+            }
+            else {
+               if (!push_search(s, number2) ||
+                   !set_visited(f, number2, i + 1)) {
+                  clear_visited(f);
+                  return false;
+               }
+            }
+         }
+      }
+
+      active = 0;
+      for (uint32_t i = 0; i < count; i++) {
+         if (search_group(f, i) == i && group_active(f, i))
+            active++;
+      }
+   }
+   clear_visited(f);
+
+   *new_areas = 0;
+   for (uint32_t i = 0; i < count; i++) {
+      if (search_group(f, i) == i)
+         (*new_areas)++;
+   }
+   return true;
+}
+
+bool fsplit(find_t *f, const board_t *board, const layout_t *l,
+            uint64_t number, uint32_t *new_areas) {
+   // Tablica visited jest alokowana dopiero przy pierwszym rozpadzie, więc
+   // gry bez złotych ruchów jej nie potrzebują.
+   if (f->node != NULL && f->visited == NULL) {
+      f->visited = calloc((f->size + 63) / 64 * BOARD_NEIGHBOURS,
+                          sizeof(uint64_t));
+      if (f->visited == NULL)
+         return false;
+   }
+
+   return split_search(f, board, l, number, new_areas);
+}
+
+bool fsplit_count(const board_t *board, const layout_t *l, uint64_t number,
+                  uint32_t *new_areas) {
+   // Struktura bez tablicy węzłów zapisuje odwiedzone pola w tablicy
+   // haszującej, której wielkość zależy tylko od liczby odwiedzonych pól.
+   search_t search[BOARD_NEIGHBOURS];
+   find_t scratch;
+   memset(search, 0, sizeof(search));
+   memset(&scratch, 0, sizeof(scratch));
+   scratch.search = search;
+   sparse_init(&scratch.visits);
+
+   bool ok = split_search(&scratch, board, l, number, new_areas);
+   for (int i = 0; i < BOARD_NEIGHBOURS; i++)
+      free(search[i].queue);
+   sparse_free(&scratch.visits);
+   return ok;
+}
+
+bool fsplit_reserve(find_t *f, const board_t *board, const layout_t *l) {
+   // Rozpad obszaru zużywa co najwyżej BOARD_NEIGHBOURS nowych węzłów.
+   // Tablicę węzłów rzadkiej planszy najpierw próbujemy powiększyć.
+   if (!check_spare(f, BOARD_NEIGHBOURS) &&
+       !grow_nodes(f, BOARD_NEIGHBOURS)) {
+      rebuild_find(f, board, l);
+      if (!check_spare(f, BOARD_NEIGHBOURS))
+         return false;
+   }
+   return true;
+}
+
+void fsplit_apply(find_t *f, uint64_t number) {
+   uint32_t count = f->searches;
+   uint32_t kept = BOARD_NEIGHBOURS;
+   uint64_t cells[BOARD_NEIGHBOURS] = {0, 0, 0, 0};
+
+   for (uint32_t i = 0; i < count; i++)
+      cells[search_group(f, i)] += f->search[i].tail;
+
+   // Pola grupy, która nie skończyła przeszukiwania, lub największej grupy,
+   // jeśli skończyły wszystkie, zachowują dotychczasowego reprezentanta.
+   for (uint32_t i = 0; i < count; i++) {
+      if (search_group(f, i) != i)
+         continue;
+      if (group_active(f, i)) {
+         kept = i;
+         break;
+      }
+      if (kept == BOARD_NEIGHBOURS || cells[i] > cells[kept])
+         kept = i;
+   }
+
+   for (uint32_t i = 0; i < count; i++) {
+      if (search_group(f, i) != i || i == kept)
+         continue;
+
+      uint32_t area = new_area(f, cells[i]);
+      for (uint32_t j = 0; j < count; j++) {
+         if (search_group(f, j) != i)
+            continue;
+         for (uint64_t k = 0; k < f->search[j].tail; k++)
+            set_area(f, f->search[j].queue[k], area);
+      }
+   }
+
+   set_area(f, number, new_area(f, 1));
+   f->searches = 0;
 }
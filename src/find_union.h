@@ -2,6 +2,11 @@
  * Interfejs struktury find_union
  * zmodyfikowanej pod wykorzystanie w zadaniu gammaa.
  *
+ * Każde pole planszy jest przypisane do węzła, a węzły tworzą drzewa, których
+ * korzenie są reprezentantami obszarów. Po rozpadzie obszaru pola odciętych
+ * części dostają nowe węzły, a ich stare węzły zostają w drzewie pozostałej
+ * części, więc nie trzeba jej przebudowywać.
+ *
  * @author Jakub Bedełek
  */
 
@@ -10,6 +15,9 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "arena.h"
+#include "board.h"
+#include "journal.h"
    
 
 /**
@@ -20,75 +28,179 @@ typedef struct find_s find_t;
 
 /** @brief Łączy obszary o reprezentantach @p number i @p val. 
  * @param[in] f       – wskaźnik na strukturę przechowującą dane,
- * @param[in] number    - numer pierwszego pola,
- * @param[in] val       - numer drugiego pola.
- @return Zwraca reprezentana pola o numerze @p numer.
+ * @param[in] number    - reprezentant pierwszego obszaru,
+ * @param[in] val       - reprezentant drugiego obszaru.
+ @return Zwraca reprezentana połączonego obszaru.
  */
-void funion(find_t *f, uint32_t number, uint32_t val);
-
-/** @brief Inicjalizuje tablicę reprezentantów i tablicę rank. 
- * @param[in] f       - wskaźnik na strukturę przechowującą dane,
- * @param[in] width   – szerokość planszy, liczba dodatnia,
- * @param[in] height  – wysokość planszy, liczba dodatnia
+uint32_t funion(find_t *f, uint32_t number, uint32_t val);
+
+/** @brief Zwraca liczbę bajtów potrzebnych na strukturę przechowującą dane
+ * i jej tablice.
+ * @param[in] size    – liczba pól, liczba dodatnia,
+ * @param[in] sparse  – wartość true, jeśli struktura jest tworzona dla
+ *                      rzadkiej planszy.
+ * @return Zwraca wielokrotność @ref ARENA_ALIGN.
  */
-void init(find_t *f, uint32_t width, uint32_t height); 
+uint64_t find_bytes(uint64_t size, bool sparse);
 
 /** @brief Wypełnia wartościami początkowymi tablicę reprezentantów i 
- * tablicę rank. 
+ * tablicę rank. Każde pole staje się osobnym obszarem.
  * @param[in] f       - wskaźnik na strukturę przechowującą dane,
- * @param[in] width   – szerokość planszy, liczba dodatnia,
- * @param[in] height  – wysokość planszy, liczba dodatnia
+ * @param[in] size    – liczba pól, liczba dodatnia.
  */
-void fill_find(find_t *f, uint32_t width, uint32_t height);
+void fill_find(find_t *f, uint64_t size);
 
-/** @brief Usuwa strukturę przechowującą dane.
+/** @brief Przywraca wartości początkowe pól o numerach z tablicy @p cells.
+ * Pola spoza tablicy @p cells nie mogły należeć do żadnego obszaru od
+ * ostatniego wywołania @ref fill_find lub @ref reset_find. Po wywołaniu
+ * każde pole jest osobnym obszarem, tak jak po @ref fill_find.
  * @param[in] f       - wskaźnik na strukturę przechowującą dane,
+ * @param[in] cells   - numery pól, które należały do obszarów,
+ * @param[in] count   - liczba pól w tablicy @p cells.
  */
-void delete_funion(find_t *f);
+void reset_find(find_t *f, const uint64_t *cells, uint64_t count);
+
+/** @brief Kopiuje obszary struktury @p src do struktury @p dst.
+ * Obie struktury muszą być utworzone dla tej samej liczby pól i tego
+ * samego rodzaju planszy.
+ * @param[in,out] dst - wskaźnik na strukturę, do której kopiujemy,
+ * @param[in] src     - wskaźnik na kopiowaną strukturę.
+ * @return Zwraca true jeśli udało się skopiować obszary lub false, jeśli
+ * nie udało się zaalokować pamięci dla rzadkiej planszy.
+ */
+bool copy_find(find_t *dst, const find_t *src);
 
-/** @brief Zmienia wielkość tablicy rank dla numeru @p number na @p val.
- * @param[in] f       - wskaźnik na strukturę przechowującą dane,
- * @param[in] number       - numer,
- * @param[in] val       - zmieniana wartośc. 
+/** @brief Przebudowuje strukturę na podstawie planszy @p board, zużywając
+ * jak najmniej węzłów. Wywoływana, gdy skończą się wolne węzły, co zdarza
+ * się nie częściej niż raz na size / 8 rozpadów obszarów. Przebudowy nie da
+ * się cofnąć, więc czyści dziennik zmian.
+ * @param[in] f         - wskaźnik na strukturę przechowującą dane,
+ * @param[in] board     - plansza,
+ * @param[in] l         - rozmieszczenie pól planszy.
+ */
+void rebuild_find(find_t *f, const board_t *board, const layout_t *l);
+
+/** @brief Ustawia dziennik, w którym są zapisywane zmiany struktury.
+ * Gdy dziennik jest ustawiony, struktura nie skraca ścieżek, więc zmiany
+ * każdego ruchu ograniczają się do kilku pól i można je cofnąć.
+ * @param[in] f         - wskaźnik na strukturę przechowującą dane,
+ * @param[in] journal   - wskaźnik na dziennik lub NULL, jeśli zmian nie
+ *                        trzeba zapisywać.
  */
-void change_rank(find_t *f, uint32_t number, uint32_t val);
+void find_journal(find_t *f, journal_t *journal);
 
-/** @brief Zmienia reprezentanta pola  o numerze @p number na @p val.
+/** @brief Zapewnia węzły dla @p cells pól rzadkiej planszy, które zostaną
+ * zajęte, tak aby kolejne wywołania @ref find nie musiały alokować pamięci.
+ * Dla planszy przechowywanej w tablicy każde pole ma węzeł.
  * @param[in] f         - wskaźnik na strukturę przechowującą dane,
- * @param[in] number    - numer,
- * @param[in] val       - zmieniana wartość. 
+ * @param[in] cells     - liczba pól.
+ * @return Zwraca true jeśli są węzły dla pól lub false, jeśli nie udało
+ * się zaalokować pamięci.
  */
-void change_rep(find_t *f, uint32_t number, uint32_t val);
+bool find_reserve(find_t *f, uint32_t cells);
 
-/** @brief Sprawdza czy pamięć została przydzielona dla parametru @p f.
+/** @brief Zapisuje obszary struktury do deskryptora pliku @p fd.
+ * Struktura nie może być utworzona dla rzadkiej planszy.
  * @param[in] f       - wskaźnik na strukturę przechowującą dane,
- * @return Zwraca jeden jeśli została przydzielona pamięć dla @p f lub 
- * 0 w przeciwnym przypadku. 
+ * @param[in] fd      - deskryptor pliku otwartego do zapisu.
+ * @return Zwraca true jeśli udało się zapisać obszary lub false
+ * w przeciwnym przypadku.
+ */
+bool save_find(const find_t *f, int fd);
+
+/** @brief Odczytuje obszary zapisane funkcją @ref save_find do struktury
+ * utworzonej dla tej samej liczby pól.
+ * Sprawdza, czy odczytane numery węzłów mieszczą się w tablicach.
+ * @param[in,out] f   - wskaźnik na strukturę przechowującą dane,
+ * @param[in] fd      - deskryptor pliku otwartego do odczytu.
+ * @return Zwraca true jeśli udało się odczytać obszary lub false, jeśli
+ * wystąpił błąd odczytu lub dane są niepoprawne.
  */
-bool check_alloc_find(find_t *f);
+bool load_find(find_t *f, int fd);
 
-/** @brief Zwiększa wartość tablicy rank dla parametru @p rep_number o 1.
- * @param[in] f       - wskaźnik na strukturę przechowującą dane,    
- * @param[in] rep_number - index tablicy, w którym ma nastąpić zmiana.
+/** @brief Zwalnia pamięć przydzieloną przez strukturę poza obszarem
+ * przekazanym do @ref new_find_t.
+ * @param[in] f       - wskaźnik na strukturę przechowującą dane,
  */
-void increase_rank(find_t *f, uint32_t rep_number); 
+void delete_funion(find_t *f);
 
 /** @brief Zwraca reprezentana pola o numerze @p rep_number. 
- * @param[in] rep_number       - numer pola,
+ * @param[in] rep_number       - numer pola, zajętego, jeśli plansza jest
+ *                               rzadka,
  * @param[in] f       – wskaźnik na strukturę przechowującą dane,
  @return Zwraca reprezentana pola o numerze @p rep_number.
  */
-uint32_t find(uint32_t rep_number, find_t *f);
-
-
-/** @brief Tworzy nową strukturę przechowującą dane.
- * @return Zwraca nową powstałą strukturę. 
+uint32_t find(uint64_t rep_number, find_t *f);
+
+/** @brief Liczy obszary, na które rozpada się obszar pola @p number po
+ * usunięciu tego pola.
+ * Z każdego sąsiada pola @p number należącego do tego samego obszaru
+ * rozpoczyna przeszukiwanie wszerz i wykonuje je naprzemiennie, po jednym
+ * polu na przeszukiwanie. Przeszukiwania, które się spotkały, przeszukują
+ * ten sam obszar. Kończy, gdy co najwyżej jedno z nich ma jeszcze pola do
+ * odwiedzenia, więc odwiedza tylko tyle pól, ile liczą mniejsze części
+ * obszaru. Nie zmienia obszarów, rozpad zatwierdza @ref fsplit_apply.
+ * @param[in] f         - wskaźnik na strukturę przechowującą dane,
+ * @param[in] board     - plansza,
+ * @param[in] l         - rozmieszczenie pól planszy,
+ * @param[in] number    - numer pola,
+ * @param[out] new_areas - liczba części, na które rozpada się obszar.
+ * @return Zwraca true jeśli udało się policzyć części lub false jeśli
+ * nie udało się zaalokować pamięci.
+ */
+bool fsplit(find_t *f, const board_t *board, const layout_t *l,
+            uint64_t number, uint32_t *new_areas);
+
+/** @brief Liczy części, na które rozpada się obszar pola @p number po
+ * usunięciu tego pola, tak jak @ref fsplit, ale bez struktury find_union.
+ * Przeszukiwania używają własnej pamięci pomocniczej, więc funkcja niczego
+ * poza nią nie zapisuje i może być wywoływana równolegle dla tej samej
+ * planszy.
+ * @param[in] board     - plansza,
+ * @param[in] l         - rozmieszczenie pól planszy,
+ * @param[in] number    - numer pola,
+ * @param[out] new_areas - liczba części, na które rozpada się obszar.
+ * @return Zwraca true jeśli udało się policzyć części lub false jeśli
+ * nie udało się zaalokować pamięci.
  */
-find_t *new_find_t();
+bool fsplit_count(const board_t *board, const layout_t *l, uint64_t number,
+                  uint32_t *new_areas);
+
+/** @brief Zapewnia węzły potrzebne funkcji @ref fsplit_apply. Jeśli nie
+ * da się ich dodać, przebudowuje strukturę, co czyści dziennik zmian, więc
+ * należy ją wywołać dopiero wtedy, gdy wiadomo, że rozpad zostanie
+ * zatwierdzony. Przebudowa nie zmienia wyników ostatniego wywołania
+ * @ref fsplit.
+ * @param[in] f         - wskaźnik na strukturę przechowującą dane,
+ * @param[in] board     - plansza,
+ * @param[in] l         - rozmieszczenie pól planszy.
+ * @return Zwraca true jeśli są węzły dla rozpadu lub false, jeśli nie
+ * udało się ich zapewnić.
+ */
+bool fsplit_reserve(find_t *f, const board_t *board, const layout_t *l);
 
-/** @brief Usuwa strukturę przechowującą dane w przypadku błędnej alokacji.
- * @param[in] f       - wskaźnik na strukturę przechowującą dane,
+/** @brief Zatwierdza rozpad obszaru policzony przez ostatnie wywołanie
+ * @ref fsplit. Odcięte części dostają nowych reprezentantów, a ich stare
+ * węzły zostają w drzewie pozostałej części. Pole @p number staje się
+ * osobnym obszarem. Wymaga wcześniejszego wywołania @ref fsplit_reserve.
+ * @param[in] f         - wskaźnik na strukturę przechowującą dane,
+ * @param[in] number    - numer pola przekazany do @ref fsplit.
+ */
+void fsplit_apply(find_t *f, uint64_t number);
+
+/** @brief Tworzy nową strukturę przechowującą dane w obszarze pamięci
+ * @p mem. Wyzerowany obszar opisuje pola będące osobnymi obszarami, więc
+ * nowej struktury nie trzeba wypełniać funkcją @ref fill_find, a strony
+ * pamięci tablic są przydzielane dopiero przy zajmowaniu pól.
+ * @param[in] mem     - wyzerowany obszar pamięci o wielkości co najmniej
+ *                      @ref find_bytes(@p size, @p sparse) bajtów,
+ *                      wyrównany do
+ *                      @ref ARENA_ALIGN,
+ * @param[in] size    – liczba pól, liczba dodatnia,
+ * @param[in] sparse  – wartość true, jeśli plansza jest rzadka; tablice
+ *                      struktury są wtedy alokowane w miarę zajmowania pól.
+ * @return Zwraca nową powstałą strukturę. 
  */
-void delete_funion_all(find_t *f);
+find_t *new_find_t(void *mem, uint64_t size, bool sparse);
 
 #endif /* FIND_UNION_H */
@@ -6,19 +6,113 @@
  * @date 10.04.2020
  */
    
+/**
+ * Dyrektywa preprocesora potrzebna do importu funkcji madvise.
+ */
+#define _DEFAULT_SOURCE
+   
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 #include "gamma.h"
 #include <inttypes.h>
+#include "arena.h"
+#include "board.h"
 #include "find_union.h"
+#include "journal.h"
+#include "planes.h"
+#include "snapshot.h"
+#include <pthread.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 
 /**
  * Stała oznaczająca maksymalną liczbe sąsiadów dla dowolnego pola gry.
  */
 #define NUM 4 
 
+/**
+ * Wielkość dużej strony pamięci. Do niej wyrównujemy obszary pamięci gry,
+ * które są od niej większe.
+ */
+#define HUGE_PAGE ((uint64_t)2 << 20)
+
+/**
+ * Górne ograniczenie liczby bajtów wszystkich buforów gry na jedno pole.
+ */
+#define MAX_CELL_BYTES 32
+
+/**
+ * Najmniejsza liczba pól planszy, której opis jest dzielony między wątki.
+ */
+#define RENDER_PARALLEL_CELLS ((uint64_t)1 << 22)
+
+/**
+ * Największa liczba wątków wypisujących planszę.
+ */
+#define RENDER_MAX_THREADS 8
+
+/**
+ * Wielkość bufora, w którym @ref gamma_board_write tworzy części napisu.
+ */
+#define RENDER_CHUNK 16384
+
+/**
+ * Największa liczba znaków opisu jednego pola.
+ */
+#define MAX_CELL_TEXT (UINT32_MAX_NUM_OF_DIGITS + 2)
+
+/**
+ * Najmniejsza liczba pól planszy razem z ramką, dla której gra przechowuje
+ * tylko zajęte pola. Pamięć takiej gry rośnie z liczbą ruchów, a nie
+ * z wielkością planszy. Domyślnie plansza jest rzadka tylko wtedy, gdy jej
+ * tablice nie mieszczą się w pamięci; mniejszą wartość można wybrać przy
+ * kompilacji.
+ */
+#ifndef SPARSE_MIN_CELLS
+#define SPARSE_MIN_CELLS UINT64_MAX
+#endif
+
+/**
+ * Liczba ostatnich zmian pól pamiętanych dla @ref gamma_changes_since.
+ */
+#define CHANGES_SIZE 4096
+
+/**
+ * Początek binarnego zapisu stanu gry.
+ */
+#define SNAPSHOT_MAGIC "GAMMASAV"
+
+/**
+ * Wersja formatu binarnego zapisu stanu gry.
+ */
+#define SNAPSHOT_VERSION 4
+
+/**
+ * Liczba liczników gracza w binarnym zapisie stanu gry.
+ */
+#define SNAPSHOT_COUNTERS 4
+
+/**
+ * Rozmieszczenie pól w binarnym zapisie stanu gry: 0 dla numeracji
+ * wierszami, 1 dla numeracji kafelkami.
+ */
+#define SNAPSHOT_LAYOUT (LAYOUT_ROW_MAJOR ? 0 : 1)
+
+/**
+ * Liczba graczy, których liczniki są zapisywane i odczytywane naraz.
+ */
+#define SNAPSHOT_PLAYERS 256
+
+/**
+ * Zapisuje w dzienniku gry @p g poprzednią wartość pola @p field przed
+ * jego zmianą.
+ */
+#define SAVE(g, field) save((g), &(field), sizeof(field))
+
 /**
  * Struktura przechowywują stan gry.
  */
@@ -30,54 +124,148 @@ typedef struct gamma gamma_t;
 typedef struct array_s array_t;
 
 /**
- * Zmienna globalna wykorzystywana do przechodzenie graafu w głąb. 
+ * Struktura opisująca jedną ramkę stosu w iteracyjnym algorytmie Tarjana.
+ */
+typedef struct frame_s frame_t;
+
+/**
+ * Struktura opisująca sąsiedztwo jednego pola planszy.
  */
-uint32_t counter = 1; 
+typedef struct neighbours_s neighbours_t;
 
 /**
  * Struktura przechowywująca stan gry.
+ * Plansza jest przechowywana w jednej tablicy, w kolejności pól wyznaczonej
+ * przez @ref layout_t, i otoczona ramką
+ * szerokości jednego pola o wartości board.border, większej od numeru
+ * każdego gracza i od zera, więc pola ramki nie są ani wolne, ani zajęte
+ * przez gracza. Dzięki temu sąsiedzi
+ * każdego pola planszy leżą w tablicy i nie trzeba sprawdzać jej brzegów.
  */
 struct gamma {
-    uint32_t **board;            /**< Tablica przechowywująca stan planszy. */
+    board_t board;               /**< Plansza razem z ramką. */
+    planes_t planes;             /**< Płaszczyzny bitowe planszy, jeśli
+                                     graczy jest niewielu. */
     uint32_t width;              /**< Szerokość planszy. */
     uint32_t height;             /**< Wysokość planszy. */
+    layout_t layout;             /**< Rozmieszczenie pól tablicy board. */
+    uint64_t mapped;             /**< Wielkość obszaru pamięci gry, jeśli
+                                     został odwzorowany funkcją mmap,
+                                     lub 0. */
     uint32_t areas;              /**< Maksymalna liczba obszarów. */
     uint32_t players;            /**< Liczba graczy. */
-    uint32_t num_of_busy_fields; /**< Liczba zajętych pól */ 
+    uint64_t num_of_busy_fields; /**< Liczba zajętych pól */ 
     array_t *arrays;             /**< Tablice o rozmiarze liczba graczy. */
+    uint64_t *active;            /**< Zbiory graczy, po dwa słowa na 64
+                                     graczy: w pierwszym bity graczy, którzy
+                                     mają wolne pola przy wolnej planszy,
+                                     w drugim bity graczy, którzy nie
+                                     wykonali złotego ruchu. */
+    uint32_t movers;             /**< Liczba graczy w pierwszym zbiorze. */
     find_t *find_union;          /**< Struktura przechowująca dane potrzebne do
                                      wykonania algorytmu find_union. */
-    uint32_t *visited;           /**< Tablica sprawdzająca czy dane pole zostało
-                                     już odwiedzone w danym przejściu dfs. */ 
+    uint32_t *disc;              /**< Czasy wejścia do pól w algorytmie Tarjana,
+                                     alokowane przy pierwszym zapytaniu
+                                     i zerowe poza analizą. */
+    sparse_t disc_map;           /**< Czasy wejścia do pól rzadkiej planszy,
+                                     puste poza analizą. */
+    frame_t *frames;             /**< Stos algorytmu Tarjana. */
+    uint64_t frames_size;        /**< Pojemność stosu frames. */
+    bool golden_valid;           /**< Wartość true jeśli wyniki zapisane w polach
+                                     golden_possible są aktualne. */
+    uint64_t *dirty;             /**< Numery pól zajętych od utworzenia lub
+                                     wyczyszczenia planszy. */
+    uint64_t dirty_count;        /**< Liczba pól w tablicy dirty. */
+    uint64_t dirty_size;         /**< Pojemność tablicy dirty. */
+    bool dirty_lost;             /**< Wartość true jeśli nie udało się
+                                     powiększyć tablicy dirty i trzeba
+                                     wyczyścić całą planszę. */
+    journal_t *journal;          /**< Dziennik zmian lub NULL, jeśli ruchów
+                                     nie można cofać. */
+    uint64_t last_move;          /**< Numer pola ostatniego ruchu, którego
+                                     poprzednia wartość jest w dzienniku. */
+    uint64_t *changes;           /**< Pierścień numerów pól ostatnich
+                                     @ref CHANGES_SIZE zmian, alokowany przy
+                                     pierwszej zmianie. */
+    uint64_t version;            /**< Liczba zmian pól od utworzenia gry. */
+    uint64_t changes_from;       /**< Najmniejsza wersja, od której znane
+                                     są wszystkie zmiany. */
+};
+
+/**
+ * Struktura opisująca jedną ramkę stosu w iteracyjnym algorytmie Tarjana.
+ */
+struct frame_s {
+    uint64_t num;               /**< Numer pola. */
+    uint32_t disc;              /**< Czas wejścia do pola. */
+    uint32_t low;               /**< Najmniejszy czas wejścia osiągalny
+                                     z poddrzewa pola. */
+    uint8_t dir;                /**< Numer następnego sprawdzanego sąsiada. */
+    uint8_t cuts;               /**< Liczba poddrzew odcinanych przez pole. */
+};
+
+/**
+ * Struktura opisująca sąsiedztwo jednego pola planszy, zbierana jednym
+ * przejściem po czterech sąsiadach.
+ */
+struct neighbours_s {
+    uint64_t num[NUM];          /**< Numery sąsiednich pól. */
+    uint32_t owner[NUM];        /**< Właściciele sąsiednich pól. */
+    uint32_t count;             /**< Liczba sąsiednich pól gracza. */
+    uint32_t roots;             /**< Liczba różnych obszarów gracza wśród
+                                     sąsiednich pól. */
+    uint32_t root[NUM];         /**< Reprezentanci różnych obszarów gracza
+                                     wśród sąsiednich pól. */
 };
 
 /**
  * Struktura przechowywująca tablice o rozmiarze liczba graczy. 
  */
 struct array_s {
-    uint32_t neighbour_fields;  /**< Tablica przyporządkowująca każdemu graczowi
+    uint64_t neighbour_fields;  /**< Tablica przyporządkowująca każdemu graczowi
                                      liczbę wolnych pól sąsiadujących z polami
                                      zajętymi przez danego gracza. */ 
     uint32_t golden_move;       /**< Tablica zawierająca 1 jeśli diff wykonał
                                      złoty ruch lub 0 w przeciwnych przypadku. */
     uint32_t num_of_areas;      /**< Tablica przechowywująca liczbę obszarów zajętych
                                      przez każdego gracza. */
-    uint32_t num_of_fields;     /**< Tablica przechowywująca liczbę pól zajętych
+    uint64_t num_of_fields;     /**< Tablica przechowywująca liczbę pól zajętych
                                      przez każdego graczaa. */
+    uint64_t golden_cells;      /**< Liczba pól gracza, na których inny gracz
+                                     może wykonać złoty ruch. */
+    bool golden_adjacent;       /**< Wartość true jeśli gracz sąsiaduje z polem,
+                                     na którym może wykonać złoty ruch. */
+    bool golden_possible;       /**< Zapamiętany wynik funkcji
+                                     @ref gamma_golden_possible. */
 };
 
+/** @brief Zwalnia obszar pamięci gry zaalokowany funkcją
+ * @ref alloc_arena. Struktura gry leży na początku obszaru.
+ * @param[in] g       – wskaźnik na strukturę przechowującą dane.
+ */
+static void free_arena(gamma_t *g) {
+#ifdef __linux__
+   if (g->mapped > 0) {
+      munmap(g, g->mapped);
+      return;
+   }
+#endif
+   free(g);
+}
+
 void gamma_delete(gamma_t *g) {
     if (g != NULL) {
-        // Usuwamy całą zaalokowaną pamieć. 
-        for (uint32_t i = 0; i < g->height; i++) {
-            free(g->board[i]); 
-        }
-        free(g->board);
-        free(g->arrays);
-        free(g->visited);
+        // Usuwamy całą zaalokowaną pamieć. Struktura g leży na początku
+        // obszaru pamięci gry, razem z planszą i pozostałymi tablicami.
+        free(g->disc);
+        sparse_free(&g->disc_map);
+        free(g->frames);
+        free(g->dirty);
+        journal_delete(g->journal);
+        free(g->changes);
         delete_funion(g->find_union); 
-        free(g->find_union);
-        free(g); 
+        board_free(&g->board);
+        free_arena(g); 
     }
 }
 
@@ -90,23 +278,65 @@ static bool check_alloc(void *ptr) {
    return (ptr == NULL);
 }
 
-/** @brief Inicjalizuje tablicę przechowującą ruchy graczy.
+/** @brief Sprawdza, czy gra przechowuje tylko zajęte pola planszy.
  * @param[in] g       – wskaźnik na strukturę przechowującą dane.
+ * @return Zwraca true jeśli plansza gry jest rzadka.
+ */
+static bool is_sparse(const gamma_t *g) {
+   return g->board.bytes == 0;
+}
+
+/** @brief Zwraca numer pola o współrzędnych @p x i @p y.
+ * @param[in] g       – wskaźnik na strukturę przechowującą dane,
+ * @param[in] x       – numer kolumny,
+ * @param[in] y       - numer wiersza.
+ @return Zwraca numer pola o współrzędnych @p x i @p y.
+ */
+static uint64_t numer(const gamma_t *g, uint32_t x, uint32_t y) {
+   return layout_cell(&g->layout, (uint64_t)x + 1, (uint64_t)y + 1);
+}
+
+/** @brief Oznacza pole ramki o numerze @p num na planszy i w płaszczyznach
+ * bitowych.
+ * @param[in] g       – wskaźnik na strukturę przechowującą dane,
+ * @param[in] num     – numer pola ramki.
+ */
+static void set_border(gamma_t *g, uint64_t num) {
+   board_set(&g->board, num, g->board.border);
+   if (g->planes.bits != NULL)
+      planes_border(&g->planes, num);
+}
+
+/** @brief Inicjalizuje tablicę przechowującą ruchy graczy.
+ * Wypełnia pola ramki wartością board.border, a pola planszy zerami,
+ * co oznacza, że są wolne. Pola planszy w wyzerowanym obszarze pamięci
+ * nie są zapisywane, więc koszt zależy tylko od liczby pól ramki.
+ * @param[in] g       – wskaźnik na strukturę przechowującą dane,
+ * @param[in] clear   – wartość true, jeśli plansza i płaszczyzny bitowe
+ *                      mogą zawierać zajęte pola i trzeba je wyzerować.
  */
-static void init_board(gamma_t *g) {
-   g->board = (uint32_t **)calloc(g->height, sizeof(uint32_t *));
-   if (g->board == NULL)
+static void init_board(gamma_t *g, bool clear) {
+   board_t *b = &g->board;
+   // Rzadka plansza wyznacza pola ramki z ich numerów.
+   if (is_sparse(g)) {
+      sparse_clear(&b->map);
       return;
-   
-   for (uint32_t i = 0; i < g->height; i++) {
-      g->board[i] = (uint32_t *)calloc(g->width, sizeof(uint32_t));
+   }
+   if (clear) {
+      memset(b->cells, 0, g->layout.size * b->bytes);
+      if (g->planes.bits != NULL)
+         memset(g->planes.bits, 0,
+                g->planes.count * g->planes.words * sizeof(uint64_t));
    }
    
-   // Wypełniamy board zerami, co oznacza, że pola są wolne.
-   for (uint32_t i = 0; i < g->height; i++) {
-      for (uint32_t j = 0; j < g->width; j++) {
-         g->board[i][j] = 0;  
-      }
+   const layout_t *l = &g->layout;
+   for (uint64_t i = 0; i < l->columns; i++) {
+      set_border(g, layout_cell(l, i, 0));
+      set_border(g, layout_cell(l, i, l->rows - 1));
+   }
+   for (uint64_t i = 1; i <= g->height; i++) {
+      set_border(g, layout_cell(l, 0, i));
+      set_border(g, layout_cell(l, l->columns - 1, i));
    }
 }
 
@@ -122,20 +352,67 @@ static void init_numbers(gamma_t *g, uint32_t width, uint32_t height,
                          uint32_t players, uint32_t areas) {
    g->width = width; 
    g->height = height; 
+   // Rozmieszczenie pól zostało już sprawdzone przez alloc_game.
+   layout_init(&g->layout, (uint64_t)width + 2, (uint64_t)height + 2);
    g->players = players;
    g->areas = areas; 
    g->num_of_busy_fields = 0;
+   g->disc = NULL;
+   sparse_init(&g->disc_map);
+   g->frames = NULL;
+   g->frames_size = 0;
+   g->golden_valid = false;
+   g->dirty = NULL;
+   g->dirty_count = g->dirty_size = 0;
+   g->dirty_lost = false;
+   g->journal = NULL;
+   g->last_move = 0;
+   g->changes = NULL;
+   g->version = g->changes_from = 0;
 }
 
-/** @brief Inicjalizuje jendnowymiarowe tablice
- *  przechowywane w strukturze @ref gamma.
- * @param[in] g       – wskaźnik na strukturę przechowującą dane.
+/** @brief Alokuje wyzerowany obszar pamięci gry o wielkości co najmniej
+ * @p bytes. Obszar jest wyrównany do @ref ARENA_ALIGN. Obszary większe od
+ * dużej strony pamięci są odwzorowywane anonimowo, wyrównane do
+ * @ref HUGE_PAGE i oznaczone tak, aby system mógł je przydzielić dużymi
+ * stronami. Ich strony są wypełnione zerami przez system i przydzielane
+ * dopiero przy pierwszym zapisie, więc nie trzeba ich zerować.
+ * @param[in] bytes   – wielkość obszaru,
+ * @param[out] mapped – wielkość odwzorowanego obszaru lub 0, jeśli obszar
+ *                      zaalokowano funkcją aligned_alloc.
+ * @return Zwraca wskaźnik na obszar lub NULL, jeśli nie udało się
+ * zaalokować pamięci.
  */
-static void init_arrays(gamma_t *g) {
-   uint32_t players = g->players + 1;  
-   
-   g->arrays = calloc(players, sizeof(array_t));
-   g->visited = calloc((uint64_t)g->width * (uint64_t)g->height, sizeof(uint32_t));
+static void *alloc_arena(uint64_t bytes, uint64_t *mapped) {
+   *mapped = 0;
+#ifdef __linux__
+   if (bytes >= HUGE_PAGE) {
+      bytes = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+      if (bytes > SIZE_MAX - HUGE_PAGE)
+         return NULL;
+      // Odwzorowujemy o dużą stronę więcej i odcinamy nadmiar po obu
+      // stronach wyrównanego obszaru.
+      char *raw = mmap(NULL, bytes + HUGE_PAGE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (raw == MAP_FAILED)
+         return NULL;
+      uint64_t head = (HUGE_PAGE - (uintptr_t)raw % HUGE_PAGE) % HUGE_PAGE;
+      if (head > 0)
+         munmap(raw, head);
+      if (HUGE_PAGE - head > 0)
+         munmap(raw + head + bytes, HUGE_PAGE - head);
+#ifdef MADV_HUGEPAGE
+      madvise(raw + head, bytes, MADV_HUGEPAGE);
+#endif
+      *mapped = bytes;
+      return raw + head;
+   }
+#endif
+   bytes = arena_align(bytes);
+   void *mem = aligned_alloc(ARENA_ALIGN, bytes);
+   if (mem != NULL)
+      memset(mem, 0, bytes);
+   return mem;
 }
 
 /** @brief Nadaje początkowe wartości nowo zdefiniowanym obiektom. 
@@ -146,660 +423,1087 @@ static void fill_arrays(gamma_t *g) {
    for (uint32_t i = 0; i <= g->players; i++) {
       g->arrays[i].golden_move = g->arrays[i].neighbour_fields = 0;
       g->arrays[i].num_of_areas = g->arrays[i].num_of_fields = 0; 
+      g->arrays[i].golden_cells = 0;
+      g->arrays[i].golden_adjacent = g->arrays[i].golden_possible = false;
    }
-   
-   // Na początku każdemu polu przydzielamy siebie jako reprezentanta.
-   // Każde pole składa się z obszaru zajmującego tylko to pole, czyli 
-   // ma wartośc 1. 
-   for (uint64_t i = 0; i < (uint64_t)g->width * (uint64_t)g->height; i++) {
-      g->visited[i] = 0; 
-   }
-   
-   fill_find(g->find_union, g->width, g->height);
 }
 
-/** @brief Usuwa g w przypadku złej alokacji.
- * @param[in] g - strukturap przechowująca stan gry.
+/** @brief Zwraca słowo zbioru @p set tablicy active zawierające bit gracza
+ * @p player.
+ * @param[in] g       – wskaźnik na strukturę przechowującą dane,
+ * @param[in] set     – 0 dla graczy mających wolne pola, 1 dla graczy,
+ *                      którzy nie wykonali złotego ruchu,
+ * @param[in] player  – numer gracza.
+ * @return Zwraca adres słowa.
  */
-static void gamma_delete_all(gamma_t *g) {
-    if (g != NULL) {
-      // Usuwamy całą zaalokowaną pamieć. 
-        if (g->board != NULL) {
-           for (uint32_t i = 0; i < g->height; i++) {
-              if (g->board[i] != NULL)
-                 free(g->board[i]); 
-           }
-        }
-        if (g->board != NULL)
-           free(g->board);
-
-        if (g->arrays != NULL) 
-           free(g->arrays);
-        if (g->visited != NULL) 
-           free(g->visited);
-        if (g->find_union != NULL)
-           delete_funion_all(g->find_union); 
-        if (g->find_union != NULL)
-           free(g->find_union);
-        free(g); 
-    }
+static uint64_t *active_word(const gamma_t *g, int set, uint32_t player) {
+   return g->active + (uint64_t)player / 64 * 2 + set;
 }
 
-gamma_t* gamma_new(uint32_t width, uint32_t height,
-                   uint32_t players, uint32_t areas) {
-   // Sprawdzamy, czy parametry zostały wprowadzone prawidłowo. 
-   if (width <= 0 || height <= 0 || players <= 0 || areas <= 0)
+/** @brief Sprawdza, czy gracz @p player ma wolne pola, jeśli na planszy
+ * są jeszcze wolne pola. Gracz, który nie osiągnął limitu obszarów, może
+ * zająć każde wolne pole, a pozostali tylko pola sąsiadujące z ich polami.
+ * @param[in] g       – wskaźnik na strukturę przechowującą dane,
+ * @param[in] player  – numer gracza.
+ * @return Zwraca true jeśli gracz należy do pierwszego zbioru tablicy
+ * active.
+ */
+static bool is_mover(const gamma_t *g, uint32_t player) {
+   return g->arrays[player].num_of_areas < g->areas ||
+          g->arrays[player].neighbour_fields > 0;
+}
+
+/** @brief Wypełnia zbiory graczy tablicy active na podstawie liczników
+ * wszystkich graczy.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą dane.
+ */
+static void fill_active(gamma_t *g) {
+   memset(g->active, 0, ((uint64_t)g->players / 64 + 1) * 2 *
+                        sizeof(uint64_t));
+   g->movers = 0;
+   for (uint32_t i = 1; i <= g->players; i++) {
+      uint64_t bit = (uint64_t)1 << (i % 64);
+      if (is_mover(g, i)) {
+         *active_word(g, 0, i) |= bit;
+         g->movers++;
+      }
+      if (g->arrays[i].golden_move == 0)
+         *active_word(g, 1, i) |= bit;
+   }
+}
+
+/** @brief Alokuje obszar pamięci gry i rozmieszcza w nim jej bufory.
+ * Nie wypełnia planszy, tablic graczy ani struktury find_union. Plansza
+ * jest rzadka, jeśli wymaga tego @p sparse, ma co najmniej
+ * @ref SPARSE_MIN_CELLS pól lub jej tablice są za duże.
+ * @param[in] width   – szerokość planszy, liczba dodatnia,
+ * @param[in] height  – wysokość planszy, liczba dodatnia,
+ * @param[in] players – liczba graczy, liczba dodatnia mniejsza od
+ *                      UINT32_MAX,
+ * @param[in] areas   – maksymalna liczba obszarów,
+ *                      jakie może zająć jeden gracz, liczba dodatnia,
+ * @param[in] sparse  – wartość true, jeśli plansza ma być rzadka.
+ * @return Wskaźnik na strukturę lub NULL, gdy nie udało się zaalokować
+ * pamięci lub plansza jest za duża.
+ */
+static gamma_t *alloc_game(uint32_t width, uint32_t height,
+                           uint32_t players, uint32_t areas, bool sparse) {
+   // Liczba pól planszy razem z ramką musi się zmieścić w typie uint64_t,
+   // a wszystkie bufory gry w jednym obszarze pamięci.
+   layout_t layout;
+   if (!layout_init(&layout, (uint64_t)width + 2, (uint64_t)height + 2))
       return NULL; 
-   // Alokujemy pamięć.
-   gamma_t *g = malloc(sizeof(gamma_t));
+   uint64_t size = layout.size;
+   // Numery węzłów struktury find_union planszy przechowywanej w tablicy
+   // muszą się zmieścić w typie uint32_t, a jej tablice w przestrzeni
+   // adresowej.
+   sparse = sparse || size >= SPARSE_MIN_CELLS || size > UINT32_MAX / 2 ||
+            size > SIZE_MAX / MAX_CELL_BYTES;
+
+   // Wszystkie bufory gry umieszczamy w jednym obszarze pamięci,
+   // zaczynającym się od struktury g. Rzadka plansza i jej węzły są
+   // alokowane osobno, w miarę zajmowania pól.
+   uint64_t arrays_bytes = ((uint64_t)players + 1) * sizeof(array_t);
+   uint64_t active_bytes = ((uint64_t)players / 64 + 1) * 2 *
+                           sizeof(uint64_t);
+   uint64_t board_bytes = sparse ? 0 : size * board_cell_bytes(players);
+   uint64_t planes = sparse ? 0 : planes_bytes(size, players);
+   uint64_t mapped;
+   char *mem = alloc_arena(arena_align(sizeof(gamma_t)) +
+                           arena_align(arrays_bytes) +
+                           arena_align(active_bytes) +
+                           arena_align(board_bytes) + planes +
+                           find_bytes(size, sparse), &mapped);
    
    // Sprawdzamy, czy pamięć została zaalokowana
-   if (g == NULL)
+   if (check_alloc(mem))
       return NULL;
       
-      
-   g->find_union = new_find_t();
-   if (g->find_union == NULL) {
-      free(g);
-      return NULL;
-   }
-   
-   // W przypadku niepowodzenia alokacji w tej funkcji funkcja 
-   // check_alloc_find zwróc wartość FALSE.
-   init(g->find_union, width, height);
+   gamma_t *g = arena_take(&mem, sizeof(gamma_t));
    init_numbers(g, width, height, players, areas); 
-   init_board(g); 
-   init_arrays(g); 
-   
-   
-   if (check_alloc_find(g->find_union) || g->visited == NULL || g->board == NULL
-       || g->arrays == NULL) {
-      delete_funion_all(g->find_union);
-      gamma_delete_all(g);
-      return false;
-   }
-   
+   g->mapped = mapped;
+   g->arrays = arena_take(&mem, arrays_bytes);
+   g->active = arena_take(&mem, active_bytes);
+   if (sparse)
+      board_init_sparse(&g->board, &g->layout);
+   else
+      board_init(&g->board, arena_take(&mem, board_bytes), players); 
+   planes_init(&g->planes, planes > 0 ? arena_take(&mem, planes) : NULL,
+               size, players);
+   g->find_union = new_find_t(mem, size, sparse);
+   return g;
+}
    
-   for (uint32_t i = 0; i < g->height; i++) {
-      if (g->board[i] == NULL) {
-        delete_funion_all(g->find_union);
-        gamma_delete_all(g);
-        return false;
-      }
-   }
+gamma_t* gamma_new(uint32_t width, uint32_t height,
+                   uint32_t players, uint32_t areas) {
+   // Sprawdzamy, czy parametry zostały wprowadzone prawidłowo. Numer gracza
+   // musi być mniejszy od wartości pól ramki.
+   if (width <= 0 || height <= 0 || players <= 0 || areas <= 0 ||
+       players == UINT32_MAX)
+      return NULL;
+
+   // Jeśli brakuje pamięci na tablice całej planszy, gra przechowuje tylko
+   // zajęte pola.
+   gamma_t *g = alloc_game(width, height, players, areas, false);
+   if (g == NULL)
+      g = alloc_game(width, height, players, areas, true);
+   if (g == NULL)
+      return NULL;
    
+   // Obszar pamięci gry jest wyzerowany, więc pola planszy są wolne,
+   // a każde z nich jest osobnym obszarem; zapisujemy tylko pola ramki.
+   init_board(g, false);
    // Wypełniamy wszystkie tablicę domyślnymi wartościami początkowymi.
    fill_arrays(g);
+   fill_active(g);
    
    return g;
 }
 
-/** @brief Sprawdza, czy parametry @p x i @p y są prawidłowe. 
- * @param[in] g       – wskaźnik na strukturę przechowującą dane,
- * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
- *                      @p width z funkcji @ref gamma_new,
- * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
- *                      @p height z funkcji @ref gamma_new.
- * @return zwraca 1 jeśli współrzędne są prawidłowe lub 0 w przeciwnym przypadku.
- */
-static bool check_x_y(gamma_t *g, uint32_t x, uint32_t y) {
-    return (x < g->width && y < g->height);
-}
-
-/** @brief Sprawdza, czy parametr @p player jest prawidłowy. 
- * @param[in] g       – wskaźnik na strukturę przechowującą dane,
- * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
- *                      @p players z funkcji @ref gamma_new,
- * @return zwraca 1 jeśli numer gracza jest prawidłowy lub 0 w przeciwnym 
- * przypadku.
- */
-static bool check_player(gamma_t *g, uint32_t player ) {
-    return (0 < player && player <= g->players);
-}
-
-/** @brief Sprawdza, czy parametr pole o współrzędnych @p x i @p y sąsiaduje
- * z polami zajętymi przez gracza @p player.  
- * @param[in] g       – wskaźnik na strukturę przechowującą dane,
- * @param[in] player – liczba graczy, liczba dodatnia,
- * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
- *                      @p width z funkcji @ref gamma_new,
- * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
- *                      @p height z funkcji @ref gamma_new.
- * @return zwraca 1 pole o współrzędnych @p x i @p y sąsiaduje
- * z polami zajętymi przez gracza @p player.  
+/** @brief Zapisuje w dzienniku poprzednią zawartość pola, jeśli ruchy
+ * można cofać.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] field   – adres zmienianego pola,
+ * @param[in] bytes   – wielkość pola w bajtach.
  */
-static bool have_neighbour(gamma_t *g, uint32_t player, uint32_t x, uint32_t y) {
-   // Sprawdzamy poprawność podanych współrzędnych. 
-   if (!check_x_y(g, x, y))
-      return false;
-   
-   uint32_t n = g->width; 
-   uint32_t m = g->height;
-   
-   // Sprawdzamy, czy pole o wsp. x i y sąsiaduje z polem gracza player.
-   if ((x + 1 <= n - 1) && g->board[y][x+1] == player)
-      return true; 
-   else if (x > 0 && g->board[y][x - 1] == player)
-      return true; 
-   else if (y > 0 && g->board[y - 1][x] == player)
-      return true; 
-   else if ((y + 1 <= m - 1) && g->board[y + 1][x] == player)
-      return true; 
-   else 
-      return false; 
+static void save(gamma_t *g, void *field, uint32_t bytes) {
+   if (g->journal != NULL)
+      journal_save(g->journal, field, bytes);
 }
 
-/** @brief Zwraca numer pola o współrzędnych @p x i @p y. 
- * @param[in] g       – wskaźnik na strukturę przechowującą dane,
- * @param[in] x       – numer kolumny,
- * @param[in] y       - numer wiersza.
- @return Zwraca numer pola o współrzędnych @p x i @p y. 
+/** @brief Ustawia wartość pola planszy o numerze @p num i jego bity
+ * w płaszczyznach, zapisując w dzienniku ich poprzednie wartości.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] num     – numer pola planszy,
+ * @param[in] player  – nowy właściciel pola lub 0 dla pola wolnego.
  */
-static uint64_t numer(gamma_t *g, uint32_t x, uint32_t y) {
-   return (uint64_t)(g->width) * (uint64_t)y + (uint64_t)x; 
+static void set_cell(gamma_t *g, uint64_t num, uint32_t player) {
+   save(g, board_addr(&g->board, num), g->board.bytes);
+   if (g->planes.bits != NULL) {
+      uint32_t old = board_get(&g->board, num);
+      save(g, planes_word(&g->planes, old, num), sizeof(uint64_t));
+      save(g, planes_word(&g->planes, player, num), sizeof(uint64_t));
+      planes_move(&g->planes, num, old, player);
+   }
+   board_set(&g->board, num, player);
 }
 
-
-/** @brief Łączy obszar zawierający pole @p x i @p y z obszarem
- * zawierającym pole @p x2 i @p y2. 
- * @param[in] g       – wskaźnik na strukturę przechowującą dane,
- * @param[in] x       - pierwsza współrzedna pierwszego pola,
- * @param[in] y       - druga współrzedna pierwszego pola,
- * @param[in] x2      - pierwsza współrzedna drugiego pola,
- * @param[in] y2       - pierwsza współrzedna drugiego pola.
- @return Zwraca 1 jeśli można połączyć obszary lub zero jeśli nie można
- * albo są już połączone. 
- */
-static bool check_link(gamma_t *g, uint32_t x, uint32_t y,
-                   uint32_t x2, uint32_t y2) {
-   // Sprawdzamy, czy pola należą do tego samego gracza oraz czy nie były
-   // już połączone.
-   return (g->board[y][x] == g->board[y2][x2] &&
-           find(numer(g, x, y), g->find_union) != find(numer(g, x2, y2),
-                      g->find_union));
-}
-
-/** @brief Łączy jeśli to możliwe obszar zawierający pole @p x i @p y 
- * z sąsiednimi polami.
+/** @brief Zapamiętuje zmianę wartości pola o numerze @p num dla
+ * @ref gamma_changes_since. Jeśli nie uda się zaalokować pierścienia
+ * zmian, wcześniejsze wersje przestają być znane.
  * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
- * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
- *                      @p players z funkcji @ref gamma_new,
- * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
- *                      @p width z funkcji @ref gamma_new,
- * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
- *                      @p height z funkcji @ref gamma_new. 
+ * @param[in] num     – numer pola planszy.
  */
-static void link_areas(gamma_t *g, uint32_t player, uint32_t x, uint32_t y) {
-   uint32_t n = g->width; 
-   uint32_t m = g->height;
-   
-   // Jeśli to możliwe łączymy pole o wsp. x i y z sąsiednimi polami. 
-   // Jest to możliwe jeśli pola nie były połączone i należą do tego
-   // samego gracza. Następnie aktualizujemy liczbe obszarów. 
-   if ((x + 1 <= n - 1) && check_link(g, x, y, x + 1, y)) {
-      g->arrays[player].num_of_areas--; 
-      funion(g->find_union, numer(g, x, y), numer(g, x + 1, y));
-   }
-   if (x > 0 && check_link(g, x, y, x - 1, y)) {
-      g->arrays[player].num_of_areas--; 
-      funion(g->find_union, numer(g, x, y), numer(g, x - 1, y));
-   } 
-   if (y > 0 && check_link(g, x, y, x, y - 1)) {
-      g->arrays[player].num_of_areas--; 
-      funion(g->find_union, numer(g, x, y), numer(g, x, y - 1));
-   }
-   if ((y + 1 <= m - 1) && check_link(g, x, y, x, y + 1)) {
-      g->arrays[player].num_of_areas--; 
-      funion(g->find_union, numer(g, x, y), numer(g, x, y + 1));
+static void record_change(gamma_t *g, uint64_t num) {
+   if (g->changes == NULL) {
+      g->changes = malloc(CHANGES_SIZE * sizeof(uint64_t));
+      if (check_alloc(g->changes)) {
+         g->changes_from = ++g->version;
+         return;
+      }
    }
-   
+   g->changes[g->version++ % CHANGES_SIZE] = num;
 }
 
-/** @brief Liczy ilość pól sąsiadujących z polem o współrzędnych @p x i @p y 
- * należących do gracza @p player. 
- * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
- * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
- *                      @p players z funkcji @ref gamma_new,
- * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
- *                      @p width z funkcji @ref gamma_new,
- * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
- *                      @p height z funkcji @ref gamma_new. 
- * @return Zwraca ilość pól sąsiadujących z polem o współrzędnych @p x i @p y 
- * należących do gracza @p player. 
- */
-static uint32_t num_neighbour_fields(gamma_t *g, uint32_t player, uint32_t x,
-                            uint32_t y) {
-   // Sprawdzamy, czy współrzędne są prawidłowe i czy pole o wsp. x i y 
-   // nie jest wolne.
-   if (!check_x_y(g, x, y) || g->board[y][x] != 0)
-      return 0;
-      
-   uint32_t count = 0; 
-   uint32_t n = g->width, m = g->height; 
-
-   // Zwiększamy wartość licznika count jeśli pole x i y sąsiaduje z polem
-   // należącym do gracza player. 
-   if ((x + 1 <= n - 1) && g->board[y][x + 1] == player)
-      count++; 
-   if (x > 0 && g->board[y][x - 1] == player)
-      count++; 
-   if (y > 0 && g->board[y - 1][x] == player)
-      count++;
-   if ((y + 1 <= m - 1) && g->board[y + 1][x] == player)
-      count++; 
-      
-   return count; 
+/** @brief Oznacza wszystkie pola jako zmienione. Wszystkie wcześniejsze
+ * wersje przestają być znane.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry.
+ */
+static void lose_changes(gamma_t *g) {
+   g->changes_from = ++g->version;
 }
 
-/** @brief Sprawdza, czy istnieją wolne pola sąsiadujące z polem o
- * współrzędnych @p x i @p y i należacym do gracza @p player i nie sąsiadujące
- * z żadnym inny polem gracza @p player. Jeśli takie istnieją to zwiększamy
- * wartość tablicy neighbourf_fields dla gracza @p player.  
- * należy do gracza @p player. 
+/** @brief Zapamiętuje, że ruch lub złoty ruch zmienił pole o numerze
+ * @p num, aby @ref gamma_undo wiedziało, które pole zmienia.
  * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
- * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
- *                      @p players z funkcji @ref gamma_new,
- * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
- *                      @p width z funkcji @ref gamma_new,
- * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
- *                      @p height z funkcji @ref gamma_new. 
+ * @param[in] num     – numer pola planszy.
  */
-static void increase_neighbour_fields(gamma_t *g, uint32_t player,
-                                      uint32_t x, uint32_t y) {
-   // Sprawdzamy, czy współrzędne są prawidłowe. 
-   if (!check_x_y(g, x, y))
-      return;
-   
-   // Aktualizujemy liczbę wolnych pól sąsiadujących z polem x i y, po wykonaniu
-   // nowego ruchu.  
-   if (num_neighbour_fields(g, player, x + 1, y) == 1)
-      g->arrays[player].neighbour_fields++; 
-   if (num_neighbour_fields(g, player, x - 1, y) == 1)
-      g->arrays[player].neighbour_fields++;
-   if (num_neighbour_fields(g, player, x, y + 1) == 1)
-      g->arrays[player].neighbour_fields++;
-   if (num_neighbour_fields(g, player, x, y - 1) == 1)
-      g->arrays[player].neighbour_fields++;
-}
-
-/** @brief Liczy ilość pól sąsiadujących z polem o współrzędnych @p x i @p y 
- * należących do gracza @p player. 
- * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
- * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
- *                      @p players z funkcji @ref gamma_new,
- * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
- *                      @p width z funkcji @ref gamma_new,
- * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
- *                      @p height z funkcji @ref gamma_new. 
- * @return Zwraca ilość pól sąsiadujących z polem o współrzędnych @p x i @p y 
- * należących do gracza @p player albo -1 jeśli parametry funkcji są niepoprawne
- * lub, pole o współrzędnych @p x i @p y nie jest wolne. 
- */
-static int32_t golden_neighbour_fields(gamma_t *g, uint32_t player, uint32_t x,
-                                       uint32_t y) {
-   // Sprawdzamy poprawność podanych współrzędnych oraz czy pole o wsp. y i x
-   // nie jest wolne. 
-   if (!check_x_y(g, x, y) || g->board[y][x] != 0)
-      return -1;
-   
-   int32_t count = 0; 
-   uint32_t n = g->width, m = g->height; 
-      
-   // Zwiększamy wartość licznika count jeśli pole x i y sąsiaduje z polem
-   // należącym do gracza player. 
-   if ((x + 1 <= n - 1) && g->board[y][x + 1] == player)
-      count++; 
-   if (x > 0 && g->board[y][x - 1] == player)
-      count++; 
-   if (y > 0 && g->board[y - 1][x] == player)
-      count++;
-   if ((y + 1 <= m - 1) && g->board[y + 1][x] == player)
-      count++; 
-   
-   return count; 
+static void note_move(gamma_t *g, uint64_t num) {
+   SAVE(g, g->last_move);
+   g->last_move = num;
+   record_change(g, num);
 }
 
-/** @brief Funkcja zmniejsza ilość wolnych pól sąsiadujących z obszarami
- * zajętymi przez gracza @p player, po wykonaniu złotego ruchu i 
- * zmianie przez pola o współrzędnych @p x i @p y właściciela. 
+/** @brief Zapamiętuje, że pole o numerze @p num zostało zajęte.
+ * Jeśli nie uda się powiększyć tablicy dirty, przestaje zapamiętywać pola,
+ * a @ref gamma_reset wyczyści całą planszę.
  * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
- * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
- *                      @p players z funkcji @ref gamma_new,
- * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
- *                      @p width z funkcji @ref gamma_new,
- * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
- *                      @p height z funkcji @ref gamma_new. 
+ * @param[in] num     – numer pola planszy.
  */
-static void golden_decrease(gamma_t *g, uint32_t player, uint32_t x, uint32_t y) {
-   // Sprawdzamy poprawność podanych współrzędnych. 
-   if (!check_x_y(g, x, y))
+static void mark_dirty(gamma_t *g, uint64_t num) {
+   if (g->dirty_lost)
       return;
-   
-   // Odejmujemy liczbę wolnych sąsiadujących pól z obszarem zajmowanym
-   // przez gracza player, jeśli golden move zmienił wystarczająco strukturę
-   // planszy. 
-   if (golden_neighbour_fields(g, player, x + 1, y) == 0)
-      g->arrays[player].neighbour_fields--; 
-   if (golden_neighbour_fields(g, player, x - 1, y) == 0)
-      g->arrays[player].neighbour_fields--;
-   if (golden_neighbour_fields(g, player, x, y + 1) == 0)
-      g->arrays[player].neighbour_fields--;
-   if (golden_neighbour_fields(g, player, x, y - 1) == 0)
-      g->arrays[player].neighbour_fields--;
-}
-
-/** @brief Funkcja sprawdzająca czy wartość parametru @p searched jest różna
- * od czterech kolejnych parametrów.
- * @param[in] searched  - numer szukanej liczby,
- * @param[in] player1  – numer gracza nr. 1, liczba dodatnia niewiększa od wartości
- *                      @p players z funkcji @ref gamma_new,
- * @param[in] player2  – numer gracza nr. 2, liczba dodatnia niewiększa od wartości
- *                      @p players z funkcji @ref gamma_new,
- * @param[in] player3  – numer gracza nr. 3, liczba dodatnia niewiększa o wartości
- *                      @p players z funkcji @ref gamma_new,
- * @param[in] player4  – numer gracza nr. 4, liczba dodatnia niewiększa od wartości
- *                      @p players z funkcji @ref gamma_new.
- * @return Zwraca 1 jeśli wartość parametru @p searched jest rożna od czterech
- * kolejnych parametrów.  
- */
-static bool diff(uint32_t searched, uint32_t player1, uint32_t player2,
-              uint32_t player3, uint32_t player4) {
-   return (searched != player1 && searched != player2 &&
-           searched != player3 && searched != player4);
+   if (g->dirty_count == g->dirty_size) {
+      uint64_t new_size = g->dirty_size < 64 ? 64 : 2 * g->dirty_size;
+      uint64_t *dirty = realloc(g->dirty, new_size * sizeof(uint64_t));
+      if (check_alloc(dirty)) {
+         g->dirty_lost = true;
+         return;
+      }
+      g->dirty = dirty;
+      g->dirty_size = new_size;
+   }
+   SAVE(g, g->dirty_count);
+   g->dirty[g->dirty_count++] = num;
 }
 
-/** @brief Po zajęciu pola o współrzędnych @p x i @p y przez, któregoś z 
- * graczy funkcja aktualizuje (zmniejsza) liczbę wolnych pól sąsiadujących
- * z zajętym polem. 
- * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
- * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
- *                      @p width z funkcji @ref gamma_new,
- * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
- *                      @p height z funkcji @ref gamma_new. 
+/** @brief Kopiuje stan gry @p src do gry @p dst o tych samych wymiarach
+ * i liczbie graczy.
+ * Tablice pomocnicze złotego ruchu i przeszukiwań nie są kopiowane, bo nie
+ * przechowują stanu gry między wywołaniami funkcji.
+ * @param[in,out] dst – wskaźnik na strukturę, do której kopiujemy,
+ * @param[in] src     – wskaźnik na kopiowaną strukturę.
+ * @return Zwraca true jeśli udało się skopiować stan gry lub false, jeśli
+ * nie udało się zaalokować pamięci rzadkiej planszy. Stan gry @p dst nie
+ * jest wtedy spójny.
  */
-static void neighbour_decrease(gamma_t *g, uint32_t x, uint32_t y) {
-   // Sprawdzamy poprawność współrzędnych. 
-   if (!check_x_y(g, x, y))
-      return;
-   
-   uint32_t n = g->width; 
-   uint32_t m = g->height;
-   // Zmienne będą służyły do zapamiętania numerów graczy z sąsiednich pól
-   // pola o wsp. x i y. 
-   uint32_t player1, player2, player3; 
-   player1 = player2 = player3 = 0; 
-      
-   // Pole x i y zostało przekształcone na pole gracza player z wolnego pola.
-   // Dlatego musimy zaaktualizować liczbę wolnych pól sąsiadujących dla
-   // graczy będących właścicielami pól sąsiadujących. 
-   if ((x + 1 <= n - 1) &&
-        diff(g->board[y][x + 1], 0, player1, player2, player3)) {
-      player1 = g->board[y][x + 1]; 
-      g->arrays[player1].neighbour_fields--;
-   }
-   if (x > 0 && diff(g->board[y][x - 1], 0, player1, player2, player3)) {
-      player2 = g->board[y][x - 1]; 
-      g->arrays[player2].neighbour_fields--;
-   } 
-   if (y > 0 && diff(g->board[y - 1][x], 0, player1, player2, player3)) {
-      player3 = g->board[y - 1][x]; 
-      g->arrays[player3].neighbour_fields--;;
+static bool copy_game(gamma_t *dst, const gamma_t *src) {
+   lose_changes(dst);
+   // Ruchów gry src nie można cofać w grze dst.
+   if (dst->journal != NULL)
+      journal_clear(dst->journal);
+   dst->areas = src->areas;
+   dst->num_of_busy_fields = src->num_of_busy_fields;
+   dst->golden_valid = src->golden_valid;
+   memcpy(dst->arrays, src->arrays,
+          ((uint64_t)src->players + 1) * sizeof(array_t));
+   memcpy(dst->active, src->active,
+          ((uint64_t)src->players / 64 + 1) * 2 * sizeof(uint64_t));
+   dst->movers = src->movers;
+   if (is_sparse(src)) {
+      if (!sparse_copy(&dst->board.map, &src->board.map))
+         return false;
    }
-   if ((y + 1 <= m - 1) &&
-        diff(g->board[y + 1][x], 0, player1, player2, player3)) {
-      g->arrays[g->board[y + 1][x]].neighbour_fields--;
+   else {
+      memcpy(dst->board.cells, src->board.cells,
+             src->layout.size * src->board.bytes);
    }
-}
-
-bool gamma_move(gamma_t *g, uint32_t player, uint32_t x, uint32_t y) {
-   if (g == NULL)
+   if (src->planes.bits != NULL)
+      planes_copy(&dst->planes, &src->planes);
+   if (!copy_find(dst->find_union, src->find_union))
       return false;
-   // Sprawdzamy poprawność parametrów i czy pole x i y nie jest wolne. 
-   if (check_x_y(g, x, y) && check_player(g, player) && g->board[y][x] == 0) {
-   // Sprawdzamy, czy diff nie przekroczy maksymalne ilości pól po zajęciu pola.
-      if (g->arrays[player].num_of_areas == g->areas 
-          && !have_neighbour(g, player, x, y))
-         return false;
-      
-      // Ruch może zostać wykonany więc aktualizujemy plansze. 
-      g->arrays[player].num_of_fields++;
-      g->num_of_busy_fields++;
-      g->board[y][x] = player;
-      
-      // Dodajemy graczowi player nowe wolne pola sąsiadujące z polem x i y. 
-      increase_neighbour_fields(g, player, x, y); 
-      // Odejmujemy graczom będącym właścicielami pól sąsiadujących z x i y
-      // liczbę wolnych pól sąsiadujących. 
-      neighbour_decrease(g, x, y); 
-      
-      // Zwiększamy liczbę zajętych obszarów przez gracza player
-      // lub łączymy w większy obszar i odejmujemy. 
-      if (!have_neighbour(g, player, x, y)) {
-         g->arrays[player].num_of_areas++;
-      }
-      else {
-         g->arrays[player].num_of_areas++;
-         link_areas(g, player, x, y); 
+
+   // Lista zajętych pól jest potrzebna funkcji gamma_reset.
+   dst->dirty_count = 0;
+   dst->dirty_lost = src->dirty_lost;
+   if (!src->dirty_lost && dst->dirty_size < src->dirty_count) {
+      uint64_t *dirty = realloc(dst->dirty,
+                                src->dirty_count * sizeof(uint64_t));
+      if (check_alloc(dirty)) {
+         dst->dirty_lost = true;
+         return true;
       }
-      
-      // Ruch został wykonany.
-      return true; 
+      dst->dirty = dirty;
+      dst->dirty_size = src->dirty_count;
    }
-   else // Ruch nie został wykonany. 
-      return false; 
+   if (!dst->dirty_lost && src->dirty_count > 0) {
+      memcpy(dst->dirty, src->dirty, src->dirty_count * sizeof(uint64_t));
+      dst->dirty_count = src->dirty_count;
+   }
+   return true;
 }
 
+gamma_t *gamma_clone(const gamma_t *src) {
+   if (src == NULL)
+      return NULL;
 
-/** @brief Sprawdza, czy gracz może wykonać złoty ruch.
- * Sprawdza, czy gracz @p player jeszcze nie wykonał w tej rozgrywce złotego
- * ruchu i jest przynajmniej jedno pole zajęte przez innego gracza.
+   gamma_t *g = alloc_game(src->width, src->height, src->players,
+                           src->areas, is_sparse(src));
+   if (g == NULL)
+      return NULL;
+
+   if (!copy_game(g, src)) {
+      gamma_delete(g);
+      return NULL;
+   }
+   return g;
+}
+
+bool gamma_clone_into(gamma_t *dst, const gamma_t *src) {
+   if (dst == NULL || src == NULL || dst->width != src->width ||
+       dst->height != src->height || dst->players != src->players ||
+       is_sparse(dst) != is_sparse(src))
+      return false;
+   // Gra, której stanu nie udało się skopiować, zaczyna od nowa.
+   if (dst != src && !copy_game(dst, src)) {
+      gamma_reset(dst);
+      return false;
+   }
+   return true;
+}
+
+/** @brief Zapisuje liczniki graczy do deskryptora pliku @p fd.
+ * Dla każdego gracza, od gracza 0, zapisuje kolejno liczby: neighbour_fields,
+ * golden_move, num_of_areas i num_of_fields. Wyniki analizy złotych ruchów
+ * nie są zapisywane.
  * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
- * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
- *                      @p players z funkcji @ref gamma_new.
- * @return Wartość @p true, jeśli gracz jeszcze nie wykonał w tej rozgrywce
- * złotego ruchu i jest przynajmniej jedno pole zajęte przez innnego gracza. 
- * Zwraca false w przeciwnym przypadku.
+ * @param[in] fd      – deskryptor pliku otwartego do zapisu.
+ * @return Zwraca true jeśli udało się zapisać liczniki.
  */
-static bool gamma_golden_possible_old(gamma_t *g, uint32_t player) {
-    if (g == NULL)
-      return false;
-    // Sprawdzamy, czy golden move dla gracza player jest możliwy. 
-    return (check_player(g, player) && g->arrays[player].golden_move == 0 
-            && g->num_of_busy_fields - g->arrays[player].num_of_fields > 0);
- }
- 
+static bool save_arrays(gamma_t *g, int fd) {
+   uint64_t buffer[SNAPSHOT_PLAYERS * SNAPSHOT_COUNTERS];
+   uint64_t count = (uint64_t)g->players + 1;
+   for (uint64_t i = 0; i < count; i += SNAPSHOT_PLAYERS) {
+      uint64_t n = count - i < SNAPSHOT_PLAYERS ? count - i : SNAPSHOT_PLAYERS;
+      for (uint64_t j = 0; j < n; j++) {
+         array_t *a = &g->arrays[i + j];
+         uint64_t *b = buffer + j * SNAPSHOT_COUNTERS;
+         b[0] = a->neighbour_fields;
+         b[1] = a->golden_move;
+         b[2] = a->num_of_areas;
+         b[3] = a->num_of_fields;
+      }
+      if (!snapshot_write(fd, buffer, n * SNAPSHOT_COUNTERS, sizeof(uint64_t)))
+         return false;
+   }
+   return true;
+}
 
-/** @brief Przechodzimy algorytmem dfs po spójnym fragmencie planszy należącym
- * do gracza @p player.  
- * Funkcja przechodzi algorytmem dfs po spójnym fragmencie planszy należaym 
- * do gracza player, jednocześnie aktualizując odwiedzone pola.
+/** @brief Odczytuje liczniki graczy zapisane funkcją @ref save_arrays.
  * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
- * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
- *                      @p players z funkcji @ref gamma_new,
- * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
- *                      @p width z funkcji @ref gamma_new,
- * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
- *                      @p height z funkcji @ref gamma_new. 
- * @param[in] rep_number - numer gracza, który jest reprezentantem pola, po którym
- *                   aktualnie przechodzimy algorytmem dfs.
- */
-static void dfs(gamma_t *g, uint32_t player, uint32_t x, uint32_t y,
-                uint32_t rep_number) {
-   // Zaznaczamy, że wierzchołek został odwiedzony. 
-   g->visited[numer(g, x, y)] = counter; 
-   // Ustawiamy nowego reprezentanta.
-   change_rep(g->find_union, numer(g, x, y), rep_number); 
-   // Zwiększamy wielkość spójnego obszaru.
-   increase_rank(g->find_union, rep_number); 
-   
-   // Jeśli nie odwiedziliśmy sąsiedniego wierzchołka oraz sąsiednie pole jest
-   // prawidłowe, to uruchamiamy kolejne przejście dfs. 
-   if (check_x_y(g, x - 1, y) && g->visited[numer(g, x-1, y)] != counter &&
-       g->board[y][x - 1] == player) { 
-      dfs(g, player, x - 1, y, rep_number); 
+ *                      z wypełnionymi tablicami graczy,
+ * @param[in] fd      – deskryptor pliku otwartego do odczytu.
+ * @return Zwraca true jeśli udało się odczytać liczniki i żaden gracz nie
+ * przekracza limitu obszarów, a liczniki wolnych pól nie mają złotego ruchu.
+ */
+static bool load_arrays(gamma_t *g, int fd) {
+   uint64_t buffer[SNAPSHOT_PLAYERS * SNAPSHOT_COUNTERS];
+   uint64_t count = (uint64_t)g->players + 1;
+   for (uint64_t i = 0; i < count; i += SNAPSHOT_PLAYERS) {
+      uint64_t n = count - i < SNAPSHOT_PLAYERS ? count - i : SNAPSHOT_PLAYERS;
+      if (!snapshot_read(fd, buffer, n * SNAPSHOT_COUNTERS, sizeof(uint64_t)))
+         return false;
+      for (uint64_t j = 0; j < n; j++) {
+         array_t *a = &g->arrays[i + j];
+         const uint64_t *b = buffer + j * SNAPSHOT_COUNTERS;
+         if (b[1] > 1 || b[2] > g->areas || (i + j == 0 && b[1] != 0))
+            return false;
+         a->neighbour_fields = b[0];
+         a->golden_move = (uint32_t)b[1];
+         a->num_of_areas = (uint32_t)b[2];
+         a->num_of_fields = b[3];
+      }
+   }
+   return true;
+}
+
+/** @brief Sprawdza, czy odczytana plansza ma ramkę o wartości board.border,
+ * a pozostałe pola są wolne lub należą do graczy. Liczby pól graczy muszą
+ * się zgadzać z odczytanymi licznikami, bo na ich podstawie jest wyznaczana
+ * długość opisu planszy.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ *                      z odczytanymi licznikami graczy.
+ * @return Zwraca true jeśli plansza jest poprawna lub false, jeśli nie jest
+ * albo nie udało się zaalokować pamięci.
+ */
+static bool check_board(gamma_t *g) {
+   uint64_t *fields = calloc((uint64_t)g->players + 1, sizeof(uint64_t));
+   if (check_alloc(fields))
+      return false;
+
+   bool ok = true;
+   for (uint64_t i = 0; ok && i < g->layout.size; i++) {
+      uint64_t column, row;
+      layout_coords(&g->layout, i, &column, &row);
+      // Pola dopełniające ostatnie bloki leżą poza planszą i są wolne.
+      if (row >= g->layout.rows || column >= g->layout.columns) {
+         ok = board_get(&g->board, i) == 0;
+         continue;
+      }
+      bool border = row == 0 || row > g->height || column == 0 ||
+                    column > g->width;
+      uint32_t owner = board_get(&g->board, i);
+      ok = border ? owner == g->board.border : owner <= g->players;
+      if (ok && !border)
+         fields[owner]++;
+   }
+
+   uint64_t busy = 0;
+   for (uint32_t i = 1; ok && i <= g->players; i++) {
+      ok = fields[i] == g->arrays[i].num_of_fields;
+      busy += fields[i];
+   }
+   free(fields);
+   return ok && busy == g->num_of_busy_fields;
+}
+
+bool gamma_save(gamma_t *g, int fd) {
+   if (g == NULL || fd < 0 || is_sparse(g))
+      return false;
+
+   uint32_t header[] = {SNAPSHOT_VERSION, g->width, g->height, g->players,
+                        g->areas, g->board.bytes, SNAPSHOT_LAYOUT};
+   uint64_t dirty[] = {g->dirty_lost, g->dirty_count};
+   return snapshot_write(fd, SNAPSHOT_MAGIC, 8, 1) &&
+          snapshot_write(fd, header, 7, sizeof(uint32_t)) &&
+          snapshot_write(fd, &g->num_of_busy_fields, 1, sizeof(uint64_t)) &&
+          save_arrays(g, fd) &&
+          snapshot_write(fd, g->board.cells, g->layout.size, g->board.bytes) &&
+          save_find(g->find_union, fd) &&
+          snapshot_write(fd, dirty, 2, sizeof(uint64_t)) &&
+          (g->dirty_lost ||
+           snapshot_write(fd, g->dirty, g->dirty_count, sizeof(uint64_t)));
+}
+
+gamma_t *gamma_load(int fd) {
+   char magic[8];
+   uint32_t header[7];
+   uint64_t busy;
+   if (fd < 0 || !snapshot_read(fd, magic, 8, 1) ||
+       memcmp(magic, SNAPSHOT_MAGIC, 8) != 0 ||
+       !snapshot_read(fd, header, 7, sizeof(uint32_t)) ||
+       !snapshot_read(fd, &busy, 1, sizeof(uint64_t)))
+      return NULL;
+
+   uint32_t width = header[1], height = header[2];
+   uint32_t players = header[3], areas = header[4];
+   if (header[0] != SNAPSHOT_VERSION || width == 0 || height == 0 ||
+       players == 0 || areas == 0 || players == UINT32_MAX ||
+       header[5] != board_cell_bytes(players) ||
+       header[6] != SNAPSHOT_LAYOUT ||
+       busy > (uint64_t)width * height)
+      return NULL;
+
+   // Stan gry z rzadką planszą nie jest zapisywany.
+   gamma_t *g = alloc_game(width, height, players, areas, false);
+   if (g == NULL)
+      return NULL;
+   if (is_sparse(g)) {
+      gamma_delete(g);
+      return NULL;
    }
-   if (check_x_y(g, x, y - 1) && g->visited[numer(g, x, y - 1)] != counter &&
-       g->board[y - 1][x] == player) {
-      dfs(g, player, x, y - 1, rep_number); 
+   g->num_of_busy_fields = busy;
+   fill_arrays(g);
+
+   // Stan gry jest odczytywany bez przeliczania obszarów; płaszczyzny
+   // bitowe są wypełniane na podstawie odczytanej planszy.
+   uint64_t dirty[2];
+   bool ok = load_arrays(g, fd) &&
+             snapshot_read(fd, g->board.cells, g->layout.size, g->board.bytes) &&
+             check_board(g) && load_find(g->find_union, fd) &&
+             snapshot_read(fd, dirty, 2, sizeof(uint64_t));
+   if (ok && dirty[0] == 0) {
+      ok = dirty[1] <= (uint64_t)width * height;
+      if (ok) {
+         g->dirty_size = dirty[1] + 1;
+         g->dirty = malloc(g->dirty_size * sizeof(uint64_t));
+         ok = !check_alloc(g->dirty) &&
+              snapshot_read(fd, g->dirty, dirty[1], sizeof(uint64_t));
+      }
+      for (uint64_t i = 0; ok && i < dirty[1]; i++)
+         ok = g->dirty[i] < g->layout.size;
+      if (ok)
+         g->dirty_count = dirty[1];
    }
-   if (check_x_y(g, x + 1, y) && g->visited[numer(g, x+1, y)] != counter &&
-       g->board[y][x + 1] == player) {
-      dfs(g, player, x + 1, y, rep_number);    
+   else {
+      g->dirty_lost = true;
    }
-   if (check_x_y(g, x, y + 1) && g->visited[numer(g, x, y + 1)] != counter &&
-       g->board[y + 1][x] == player) {
-      dfs(g, player, x, y + 1, rep_number);
+   if (!ok) {
+      gamma_delete(g);
+      return NULL;
    }
-   
+   if (g->planes.bits != NULL)
+      planes_fill(&g->planes, &g->board, g->layout.size);
+   fill_active(g);
+   return g;
 }
 
-/** @brief Funkcja sprawdzająca czy wartość parametru @p a jest różna
- * od czterech kolejnych parametrów.
- * @param[in] a   - liczba porównywana z innymi,
- * @param[in] l1  – liczba nr. 1,
- * @param[in] l2  – liczba nr. 2,
- * @param[in] l3  – liczba nr. 3,
- * @param[in] l4  – liczba nr. 4.
- * @return Zwraca 1 jeśli wartość parametru @p a jest rożna od czterech
- * kolejnych parametrów.  
- */
-static bool different_num(uint32_t a, uint32_t l1, uint32_t l2, uint32_t l3,
-                  uint32_t l4) {
-   return (a != l1 && a != l2 && a != l3 && a != l4);
+void gamma_reset(gamma_t *g) {
+   if (g == NULL)
+      return;
+
+   // Złote ruchy zmieniają tylko właścicieli zajętych pól, więc wystarczy
+   // wyczyścić pola zajęte zwykłymi ruchami.
+   if (g->dirty_lost || is_sparse(g)) {
+      init_board(g, true);
+      fill_find(g->find_union, g->layout.size);
+   }
+   else {
+      for (uint64_t i = 0; i < g->dirty_count; i++) {
+         uint64_t num = g->dirty[i];
+         if (g->planes.bits != NULL)
+            planes_move(&g->planes, num, board_get(&g->board, num), 0);
+         board_set(&g->board, num, 0);
+      }
+      reset_find(g->find_union, g->dirty, g->dirty_count);
+   }
+   g->dirty_count = 0;
+   g->dirty_lost = false;
+   if (g->journal != NULL)
+      journal_clear(g->journal);
+
+   fill_arrays(g);
+   fill_active(g);
+   g->num_of_busy_fields = 0;
+   g->golden_valid = false;
+   lose_changes(g);
+}
+
+bool gamma_set_undo(gamma_t *g, bool enabled) {
+   if (g == NULL)
+      return false;
+   if (!enabled) {
+      find_journal(g->find_union, NULL);
+      journal_delete(g->journal);
+      g->journal = NULL;
+      return true;
+   }
+   if (g->journal != NULL)
+      return true;
+   // Wpisy rzadkiej planszy zmieniają adresy przy powiększaniu tablicy
+   // haszującej, więc dziennik nie może ich zapisywać.
+   if (is_sparse(g))
+      return false;
+
+   g->journal = journal_new();
+   if (check_alloc(g->journal))
+      return false;
+   // Przebudowa zwalnia węzły zużyte przez wcześniejsze rozpady obszarów,
+   // więc kolejna przebudowa, czyszcząca dziennik, nastąpi jak najpóźniej.
+   rebuild_find(g->find_union, &g->board, &g->layout);
+   find_journal(g->find_union, g->journal);
+   return true;
 }
 
+bool gamma_undo(gamma_t *g) {
+   if (g == NULL || g->journal == NULL)
+      return false;
+   // Dziennik przywraca pole last_move poprzedniego ruchu.
+   uint64_t num = g->last_move;
+   if (!journal_undo(g->journal))
+      return false;
+   record_change(g, num);
+   g->golden_valid = false;
+   return true;
+}
 
-/** @brief Funkcja rozpoczyna w danym polu algorytm dfs. 
- * Jeśli pole o wsp. @p x i @p y jest zajmowane przez gracza @p player2, to
- * rozpoczynamy w tym polu algorytm dfs, po wszystkich spójych polach należaych
- * do gracza @p player. Przyjmujemy, że pole, w którym zaczeliśmy staje się 
- * reprezentantem wszystkich odwiedzonych pól. 
- * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
- * @param[in] player2  – numer gracza, liczba dodatnia niewiększa od wartości
- *                      @p players z funkcji @ref gamma_new,
+/** @brief Sprawdza, czy parametry @p x i @p y są prawidłowe. 
+ * @param[in] g       – wskaźnik na strukturę przechowującą dane,
  * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
  *                      @p width z funkcji @ref gamma_new,
  * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
- *                      @p height z funkcji @ref gamma_new. 
- * @return Zwracama 1 jeśli pole o wsp. @p x i @p y należy do gracza @p player2
- * lub 0 w przeciwnym przypadku.
+ *                      @p height z funkcji @ref gamma_new.
+ * @return zwraca 1 jeśli współrzędne są prawidłowe lub 0 w przeciwnym przypadku.
  */
-static bool start_dfs(gamma_t *g, uint32_t player2, uint32_t x, uint32_t y) {
-   if (g->board[y][x] == player2) {  
-      counter++; 
-      
-      uint64_t num = numer(g, x, y);
-      change_rep(g->find_union, num, num);
-      change_rank(g->find_union, num, 1);
-      dfs(g, player2, x, y, num); 
-      return true; 
+static bool check_x_y(const gamma_t *g, uint32_t x, uint32_t y) {
+    return (x < g->width && y < g->height);
+}
+
+/** @brief Sprawdza, czy parametr @p player jest prawidłowy. 
+ * @param[in] g       – wskaźnik na strukturę przechowującą dane,
+ * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
+ *                      @p players z funkcji @ref gamma_new,
+ * @return zwraca 1 jeśli numer gracza jest prawidłowy lub 0 w przeciwnym 
+ * przypadku.
+ */
+static bool check_player(const gamma_t *g, uint32_t player ) {
+    return (0 < player && player <= g->players);
+}
+
+/** @brief Liczy pola gracza @p player sąsiadujące z polem o numerze @p num.
+ * Pole musi leżeć na planszy, więc wszyscy jego sąsiedzi leżą w tablicy
+ * board (być może na ramce).
+ * @param[in] g       – wskaźnik na strukturę przechowującą dane,
+ * @param[in] player  – numer gracza,
+ * @param[in] num     – numer pola planszy.
+ * @return Zwraca liczbę pól gracza @p player sąsiadujących z polem @p num.
+ */
+static uint32_t count_neighbours(const gamma_t *g, uint32_t player, uint64_t num) {
+   return board_count(&g->board, &g->layout, num, player);
+}
+
+/** @brief Zbiera informacje o sąsiedztwie pola o numerze @p num.
+ * Jednym przejściem po czterech sąsiadach zapamiętuje ich numery
+ * i właścicieli, liczy pola gracza @p player i wyznacza różnych
+ * reprezentantów obszarów gracza @p player, z którymi pole sąsiaduje.
+ * @param[in] g       – wskaźnik na strukturę przechowującą dane,
+ * @param[in] player  – numer gracza, dla którego szukamy obszarów,
+ * @param[in] num     – numer pola planszy,
+ * @param[out] nb     – wskaźnik na strukturę opisującą sąsiedztwo.
+ */
+static void gather_neighbours(gamma_t *g, uint32_t player, uint64_t num,
+                              neighbours_t *nb) {
+   nb->count = nb->roots = 0;
+   // Zerujemy reprezentantów, aby tablica nie zawierała przypadkowych wartości.
+   memset(nb->root, 0, sizeof(nb->root));
+
+   board_owners(&g->board, &g->layout, num, nb->owner);
+   for (int i = 0; i < NUM; i++) {
+      nb->num[i] = layout_step(&g->layout, num, i);
+      if (nb->owner[i] != player)
+         continue;
+
+      nb->count++;
+      uint32_t root = find(nb->num[i], g->find_union);
+      bool seen = false;
+      for (uint32_t j = 0; j < nb->roots; j++)
+         seen |= (nb->root[j] == root);
+      if (!seen)
+         nb->root[nb->roots++] = root;
    }
-   else {
+}
+
+/** @brief Sprawdza, czy @p i-ty sąsiad opisany w @p nb jest pierwszym
+ * sąsiadem należącym do swojego właściciela.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] nb      – wskaźnik na strukturę opisującą sąsiedztwo,
+ * @param[in] i       – numer sąsiada.
+ * @return Zwraca true jeśli @p i-ty sąsiad należy do gracza i żaden
+ * wcześniejszy sąsiad nie należy do tego samego gracza.
+ */
+static bool first_owner(const gamma_t *g, const neighbours_t *nb, int i) {
+   uint32_t owner = nb->owner[i];
+   if (owner == 0 || owner == g->board.border)
       return false;
+   for (int j = 0; j < i; j++) {
+      if (nb->owner[j] == owner)
+         return false;
    }
+   return true;
 }
 
-/** @brief  Przywraca plansze do pierwotnego stanu po tym jak na polu @p x i @p y
- * nie mógł zostać wykonany złoty ruch. 
- * Przywraca pierwotny stan planszy po rozłączeniu obszarów powstałych przez
- * zmiane właściciela pola o wsp. @p x i @p y. Zmienia także właściciela tego
- * pola na właściciela sprzed złotego ruchu. Aktualizuje liczbę obszarów
- * powstałych po złączeniu pól gracza @p player z polem @p x i @p y. 
+/** @brief Łączy obszar zawierający pole @p num ze wszystkimi obszarami
+ * gracza @p player, z którymi sąsiaduje, i aktualizuje liczbę obszarów.
  * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
- * @param[in] player2  – numer gracza, liczba dodatnia niewiększa od wartości
+ * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
  *                      @p players z funkcji @ref gamma_new,
- * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
- *                      @p width z funkcji @ref gamma_new,
- * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
- *                      @p height z funkcji @ref gamma_new,
- * @param[in] new_areas - ilość nowopowstałych obszarów, po wyłączeniu pola 
- *                   @p x i @p y z pól gracza nr. @p player. 
+ * @param[in] num     – numer pola planszy,
+ * @param[in] nb      – sąsiedztwo pola zebrane dla gracza @p player.
  */
-static void golden_move_failed(gamma_t *g, uint32_t player2, uint32_t x,
-                               uint32_t y, uint32_t new_areas) {
-   g->board[y][x] = player2; 
-   change_rank(g->find_union, numer(g, x, y), 1);
-   change_rep(g->find_union, numer(g, x, y), numer(g, x, y));
-   link_areas(g, player2, x, y);
-   g->arrays[player2].num_of_areas += new_areas;
+static void link_areas(gamma_t *g, uint32_t player, uint64_t num,
+                       const neighbours_t *nb) {
+   uint32_t root = find(num, g->find_union);
+   g->arrays[player].num_of_areas -= nb->roots;
+   for (uint32_t i = 0; i < nb->roots; i++)
+      root = funion(g->find_union, root, nb->root[i]);
 }
 
-/** @brief Funkcja zwracająca true jeśli gracz @p player może wykonać złotych 
- * ruch na polu o numerze @p x i @p y.
+/** @brief Zwiększa liczbę wolnych pól sąsiadujących z polami gracza
+ * @p player o te wolne pola sąsiadujące z polem @p num, które nie sąsiadują
+ * z żadnym innym polem gracza @p player. Pole @p num należy już do gracza.
  * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
- * @param[in] player  – numer gracza wykonującego złoty ruch, liczba dodatnia
- *                      niewiększa od wartości @p players z funkcji 
- *                      @ref gamma_new,
- * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
- *                      @p width z funkcji @ref gamma_new,
- * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
- *                      @p height z funkcji @ref gamma_new.
- * @return Zwraca true jeśli na polu @p x i @p y gracz @p player może wykonać
- *         złoty ruch.
+ * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
+ *                      @p players z funkcji @ref gamma_new,
+ * @param[in] nb      – sąsiedztwo pola @p num.
  */
-static bool gamma_golden_possible_x_y(gamma_t *g, uint32_t player,
-                                      uint32_t x, uint32_t y) {
-   if (check_player(g, player) && check_x_y (g, x, y) && 
+static void increase_neighbour_fields(gamma_t *g, uint32_t player,
+                                      const neighbours_t *nb) {
+   SAVE(g, g->arrays[player].neighbour_fields);
+   for (int i = 0; i < NUM; i++) {
+      if (nb->owner[i] == 0 && count_neighbours(g, player, nb->num[i]) == 1)
+         g->arrays[player].neighbour_fields++;
+   }
+}
+
+/** @brief Funkcja zmniejsza ilość wolnych pól sąsiadujących z obszarami
+ * zajętymi przez gracza @p player, po wykonaniu złotego ruchu i 
+ * zmianie przez pole o numerze @p num właściciela. Pole @p num jest
+ * w chwili wywołania wolne.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
+ *                      @p players z funkcji @ref gamma_new,
+ * @param[in] nb      – sąsiedztwo pola @p num.
+ */
+static void golden_decrease(gamma_t *g, uint32_t player,
+                            const neighbours_t *nb) {
+   // Odejmujemy liczbę wolnych sąsiadujących pól z obszarem zajmowanym
+   // przez gracza player, jeśli golden move zmienił wystarczająco strukturę
+   // planszy. 
+   SAVE(g, g->arrays[player].neighbour_fields);
+   for (int i = 0; i < NUM; i++) {
+      if (nb->owner[i] == 0 && count_neighbours(g, player, nb->num[i]) == 0)
+         g->arrays[player].neighbour_fields--;
+   }
+}
+
+/** @brief Po zajęciu wolnego pola przez, któregoś z graczy funkcja
+ * aktualizuje (zmniejsza) liczbę wolnych pól sąsiadujących z polami
+ * właścicieli pól sąsiednich.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] nb      – sąsiedztwo zajętego pola.
+ */
+static void neighbour_decrease(gamma_t *g, const neighbours_t *nb) {
+   for (int i = 0; i < NUM; i++) {
+      if (first_owner(g, nb, i)) {
+         SAVE(g, g->arrays[nb->owner[i]].neighbour_fields);
+         g->arrays[nb->owner[i]].neighbour_fields--;
+      }
+   }
+}
+
+/** @brief Uaktualnia bity gracza @p player w zbiorach tablicy active po
+ * zmianie jego liczników, zapisując w dzienniku poprzednie wartości.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] player  – numer gracza lub wartość pola ramki, która nie
+ *                      należy do żadnego zbioru.
+ */
+static void update_active(gamma_t *g, uint32_t player) {
+   if (player == 0 || player > g->players)
+      return;
+   uint64_t bit = (uint64_t)1 << (player % 64);
+   uint64_t *word = active_word(g, 0, player);
+   if (((*word & bit) != 0) != is_mover(g, player)) {
+      SAVE(g, *word);
+      SAVE(g, g->movers);
+      *word ^= bit;
+      if (*word & bit)
+         g->movers++;
+      else
+         g->movers--;
+   }
+   word = active_word(g, 1, player);
+   if (((*word & bit) != 0) != (g->arrays[player].golden_move == 0)) {
+      SAVE(g, *word);
+      *word ^= bit;
+   }
+}
+
+bool gamma_move(gamma_t *g, uint32_t player, uint32_t x, uint32_t y) {
+   if (g == NULL)
+      return false;
+   // Sprawdzamy poprawność parametrów i czy pole x i y nie jest wolne. 
+   if (!check_x_y(g, x, y) || !check_player(g, player))
+      return false;
+      
+   uint64_t num = numer(g, x, y);
+   if (board_get(&g->board, num) != 0)
+      return false;
+      
+   neighbours_t nb;
+   gather_neighbours(g, player, num, &nb);
+   // Sprawdzamy, czy gracz nie przekroczy maksymalne ilości pól po zajęciu pola.
+   if (g->arrays[player].num_of_areas == g->areas && nb.count == 0)
+      return false;
+   // Rzadka plansza potrzebuje miejsca na nowe pole i jego węzeł.
+   if (!board_reserve(&g->board, 1) || !find_reserve(g->find_union, 1))
+      return false;
+      
+   // Ruch może zostać wykonany więc aktualizujemy plansze, zapisując
+   // w dzienniku poprzednie wartości zmienianych pól.
+   if (g->journal != NULL)
+      journal_mark(g->journal);
+   SAVE(g, g->arrays[player].num_of_fields);
+   SAVE(g, g->num_of_busy_fields);
+   g->arrays[player].num_of_fields++;
+   g->num_of_busy_fields++;
+   set_cell(g, num, player);
+   mark_dirty(g, num);
+   note_move(g, num);
+      
+   // Dodajemy graczowi player nowe wolne pola sąsiadujące z polem x i y.
+   increase_neighbour_fields(g, player, &nb);
+   // Odejmujemy graczom będącym właścicielami pól sąsiadujących z x i y
+   // liczbę wolnych pól sąsiadujących.
+   neighbour_decrease(g, &nb);
+
+   // Zwiększamy liczbę zajętych obszarów przez gracza player
+   // i łączymy w większy obszar z sąsiednimi obszarami.
+   SAVE(g, g->arrays[player].num_of_areas);
+   g->arrays[player].num_of_areas++;
+   link_areas(g, player, num, &nb);
+
+   // Liczniki zmieniły się tylko graczowi player i właścicielom pól
+   // sąsiednich.
+   update_active(g, player);
+   for (int i = 0; i < NUM; i++)
+      update_active(g, nb.owner[i]);
+
+   // Zapamiętane wyniki złotych ruchów są już nieaktualne.
+   g->golden_valid = false;
+   // Ruch został wykonany.
+   return true;
+}
+
+
+/** @brief Sprawdza, czy gracz może wykonać złoty ruch.
+ * Sprawdza, czy gracz @p player jeszcze nie wykonał w tej rozgrywce złotego
+ * ruchu i jest przynajmniej jedno pole zajęte przez innego gracza.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
+ *                      @p players z funkcji @ref gamma_new.
+ * @return Wartość @p true, jeśli gracz jeszcze nie wykonał w tej rozgrywce
+ * złotego ruchu i jest przynajmniej jedno pole zajęte przez innnego gracza. 
+ * Zwraca false w przeciwnym przypadku.
+ */
+static bool gamma_golden_possible_old(const gamma_t *g, uint32_t player) {
+    if (g == NULL)
+      return false;
+    // Sprawdzamy, czy golden move dla gracza player jest możliwy. 
+    return (check_player(g, player) && g->arrays[player].golden_move == 0 
+            && g->num_of_busy_fields - g->arrays[player].num_of_fields > 0);
+ }
+ 
+
+bool gamma_golden_check(const gamma_t *g, uint32_t player,
+                        uint32_t x, uint32_t y) {
+   if (g != NULL && check_player(g, player) && check_x_y (g, x, y) &&
        gamma_golden_possible_old(g, player)) {
+      uint64_t num = numer(g, x, y);
       // Sprawdzamy, czy pole nie należy do graczy i czy nie jest wolne.
-      if (g->board[y][x] == player || g->board[y][x] == 0)
+      if (board_get(&g->board, num) == player ||
+          board_get(&g->board, num) == 0)
          return false;
       // Ustawiam player2 jako poprzedniego właściciela pola x i y. 
-      uint32_t player2 = g->board[y][x];
-      // c1, c2, c3, c4 - numery globalnego licznika dla nowych wywołań dfs.
+      uint32_t player2 = board_get(&g->board, num);
       // new_areas - ilość nowych obszarów gracza player2 powstałych po
-      // zmianie właściciela pola o wsp. x i y. 
-      uint32_t c1 = 1, c2 = 1, c3 = 1, c4 = 1, new_areas = 0; 
-      g->board[y][x] = 0; 
-      
-      if (check_x_y(g, x - 1, y) && start_dfs(g, player2, x - 1, y)) {
-         new_areas++; 
-         c1 = counter; 
-      }
-      if (check_x_y(g, x, y - 1) 
-          && different_num(g->visited[numer(g, x, y - 1)], c1, c2, c3, c4)
-          && start_dfs(g, player2, x, y - 1)) {
-         new_areas++;
-         c2 = counter; 
+      // zmianie właściciela pola o wsp. x i y. Części liczymy bez
+      // struktury find_union, więc stan gry pozostaje niezmieniony.
+      uint32_t new_areas;
+      return fsplit_count(&g->board, &g->layout, num, &new_areas) &&
+         !(g->arrays[player2].num_of_areas + new_areas - 1 > g->areas ||
+           (count_neighbours(g, player, num) == 0 &&
+            g->arrays[player].num_of_areas + 1 > g->areas));
+   }
+   else {
+      return false;
+   }
+}
+ 
+/** @brief Przydziela pamięć potrzebną do wykonania algorytmu Tarjana.
+ * Tablica disc jest zerowana przez system i jej strony są przydzielane
+ * dopiero przy zapisie, więc analiza zajmuje pamięć tylko dla zajętych
+ * pól. Rzadka plansza przechowuje czasy wejścia w tablicy haszującej
+ * z miejscem na wszystkie zajęte pola. Stos mieści największy obszar,
+ * czyli co najwyżej wszystkie pola jednego gracza.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry.
+ * @return Zwraca true jeśli pamięć została przydzielona lub false jeśli
+ * nie udało się jej zaalokować albo plansza jest zbyt duża.
+ */
+static bool init_golden_analysis(gamma_t *g) {
+   // Czasy wejścia muszą się zmieścić w typie uint32_t.
+   if (is_sparse(g)) {
+      if (g->num_of_busy_fields >= UINT32_MAX ||
+          !sparse_reserve(&g->disc_map, g->num_of_busy_fields))
+         return false;
+   }
+   else if (g->layout.size >= UINT32_MAX) {
+      return false;
+   }
+   else if (g->disc == NULL) {
+      g->disc = calloc(g->layout.size, sizeof(uint32_t));
+      if (check_alloc(g->disc))
+         return false;
+   }
+
+   uint64_t largest = 0;
+   for (uint32_t i = 1; i <= g->players; i++) {
+      if (g->arrays[i].num_of_fields > largest)
+         largest = g->arrays[i].num_of_fields;
+   }
+   if (g->frames_size < largest) {
+      uint64_t new_size = 2 * g->frames_size < largest ?
+                          largest : 2 * g->frames_size;
+      frame_t *frames = realloc(g->frames, new_size * sizeof(frame_t));
+      if (check_alloc(frames))
+         return false;
+      g->frames = frames;
+      g->frames_size = new_size;
+   }
+   return true;
+}
+
+/** @brief Zapisuje, czy na polu @p num można wykonać złoty ruch.
+ * Pole należące do gracza player2 można zająć złotym ruchem, jeśli po jego
+ * usunięciu gracz player2 nie przekroczy maksymalnej liczby obszarów.
+ * Dla takiego pola zwiększamy licznik pól gracza player2 i zaznaczamy
+ * sąsiadujących z nim graczy.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] num     – numer pola planszy,
+ * @param[in] new_areas - ilość obszarów, na które rozpadnie się obszar
+ *                        zawierający pole @p num po jego usunięciu.
+ */
+static void golden_cell(gamma_t *g, uint64_t num, uint32_t new_areas) {
+   uint32_t player2 = board_get(&g->board, num);
+   if ((uint64_t)g->arrays[player2].num_of_areas + new_areas >
+       (uint64_t)g->areas + 1)
+      return;
+
+   uint32_t owner[NUM];
+   board_owners(&g->board, &g->layout, num, owner);
+   g->arrays[player2].golden_cells++;
+   for (int i = 0; i < NUM; i++) {
+      if (owner[i] != player2 && owner[i] != g->board.border)
+         g->arrays[owner[i]].golden_adjacent = true;
+   }
+}
+
+/** @brief Zwraca czas wejścia do pola @p num w algorytmie Tarjana.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] num     – numer pola planszy.
+ * @return Zwraca czas wejścia lub 0, jeśli pole nie zostało odwiedzone.
+ */
+static uint32_t get_disc(const gamma_t *g, uint64_t num) {
+   if (!is_sparse(g))
+      return g->disc[num];
+   uint32_t *slot = sparse_slot(&g->disc_map, num);
+   return slot != NULL ? *slot : 0;
+}
+
+/** @brief Odwiedza pole @p num w algorytmie Tarjana: ustawia jego czas
+ * wejścia na kolejną wartość licznika i wkłada je na stos. Pamięć rzadkiej
+ * planszy została zarezerwowana przez @ref init_golden_analysis, więc
+ * zapis się udaje.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] num     – numer pola planszy,
+ * @param[in,out] timer - licznik czasu wejścia do pól,
+ * @param[in,out] top – liczba ramek na stosie.
+ */
+static void tarjan_visit(gamma_t *g, uint64_t num, uint32_t *timer,
+                         uint64_t *top) {
+   ++(*timer);
+   if (is_sparse(g))
+      sparse_put(&g->disc_map, num, *timer);
+   else
+      g->disc[num] = *timer;
+   g->frames[(*top)++] = (frame_t){num, *timer, *timer, 0, 0};
+}
+
+/** @brief Przechodzi iteracyjnym algorytmem Tarjana po obszarze zawierającym
+ * pole @p start.
+ * Dla każdego pola obszaru liczy, na ile obszarów rozpadnie się on po
+ * usunięciu tego pola (pole jest punktem artykulacji, jeśli na więcej
+ * niż jeden), i przekazuje wynik do funkcji @ref golden_cell.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] start   – numer pola planszy,
+ * @param[in,out] timer - licznik czasu wejścia do pól.
+ */
+static void tarjan(gamma_t *g, uint64_t start, uint32_t *timer) {
+   uint32_t player2 = board_get(&g->board, start);
+   uint64_t top = 0;
+
+   tarjan_visit(g, start, timer, &top);
+
+   while (top > 0) {
+      frame_t *f = &g->frames[top - 1];
+      uint64_t num = f->num;
+
+      if (f->dir < NUM) {
+         uint64_t num2 = layout_step(&g->layout, num, f->dir);
+         f->dir++;
+         if (board_get(&g->board, num2) != player2)
+            continue;
+
+         uint32_t disc2 = get_disc(g, num2);
+         if (disc2 == 0)
+            tarjan_visit(g, num2, timer, &top);
+         else if (disc2 < f->low)
+            f->low = disc2;
+         continue;
       }
-      if (check_x_y(g, x + 1, y) 
-          && different_num(g->visited[numer(g, x + 1, y)], c1, c2, c3, c4)
-          && start_dfs(g, player2, x + 1, y)) {
-         new_areas++;
-         c3 = counter; 
+
+      // Wszyscy sąsiedzi zostali przetworzeni. Pole niebędące korzeniem
+      // oddziela dodatkowo część obszaru zawierającą swojego rodzica.
+      top--;
+      golden_cell(g, num, f->cuts + (top > 0 ? 1 : 0));
+
+      if (top > 0) {
+         frame_t *parent = &g->frames[top - 1];
+         if (f->low < parent->low)
+            parent->low = f->low;
+         if (f->low >= parent->disc)
+            parent->cuts++;
       }
-      if (check_x_y(g, x, y+1) 
-          && different_num(g->visited[numer(g, x, y+1)], c1, c2, c3, c4) 
-          && start_dfs(g, player2, x, y + 1)) {
-         new_areas++;
+   }
+}
+
+/** @brief Wyznacza dla wszystkich graczy możliwość wykonania złotego ruchu.
+ * Jednym przejściem algorytmu Tarjana po zajętych polach liczy dla każdego
+ * z nich, na ile części rozpadnie się obszar po jego usunięciu. Zajęte pola
+ * bierze z tablicy dirty, a tylko gdy jej nie ma, przegląda całą planszę.
+ * Wyniki zapisuje w polach golden_possible do czasu wykonania kolejnego
+ * ruchu.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry.
+ * @return Zwraca true jeśli udało się wyznaczyć wyniki lub false jeśli nie
+ * udało się zaalokować pamięci.
+ */
+static bool golden_analysis(gamma_t *g) {
+   if (!init_golden_analysis(g))
+      return false;
+
+   uint64_t all_cells = 0;
+   uint32_t timer = 0;
+
+   for (uint32_t i = 0; i <= g->players; i++) {
+      g->arrays[i].golden_cells = 0;
+      g->arrays[i].golden_adjacent = false;
+   }
+
+   // Poza analizą tablica disc jest wyzerowana, więc po przejściu zerujemy
+   // tylko odwiedzone pola.
+   if (!g->dirty_lost) {
+      for (uint64_t i = 0; i < g->dirty_count; i++) {
+         uint64_t num = g->dirty[i];
+         if (board_get(&g->board, num) != 0 && get_disc(g, num) == 0)
+            tarjan(g, num, &timer);
       }
-      // Sprawdzamy, czy golden move może być wykonany i przywracamy
-      // poprzedni stan planszy. 
-      if (g->arrays[player2].num_of_areas + new_areas - 1 > g->areas ||
-         (!have_neighbour(g, player, x, y) && 
-          g->arrays[player].num_of_areas + 1 > g->areas)) {
-         golden_move_failed(g, player2, x, y, new_areas);
-         return false; 
+      if (!is_sparse(g)) {
+         for (uint64_t i = 0; i < g->dirty_count; i++)
+            g->disc[g->dirty[i]] = 0;
       }
-      else {
-         golden_move_failed(g, player2, x, y, new_areas);
-         return true;
+   }
+   else if (is_sparse(g)) {
+      // Przechodzimy tylko po zajętych polach, zapisanych w planszy.
+      uint64_t pos = 0, num;
+      uint32_t player;
+      while (sparse_next(&g->board.map, &pos, &num, &player)) {
+         if (player != 0 && get_disc(g, num) == 0)
+            tarjan(g, num, &timer);
       }
    }
    else {
-      return false;
+      for (uint32_t i = 0; i < g->height; i++) {
+         uint64_t num = numer(g, 0, i);
+         for (uint32_t j = 0; j < g->width;
+              j++, num = LAYOUT_NEXT(&g->layout, num)) {
+            if (board_get(&g->board, num) != 0 && g->disc[num] == 0)
+               tarjan(g, num, &timer);
+         }
+      }
+      memset(g->disc, 0, g->layout.size * sizeof(uint32_t));
    }
+   if (is_sparse(g))
+      sparse_clear(&g->disc_map);
+
+   for (uint32_t i = 1; i <= g->players; i++)
+      all_cells += g->arrays[i].golden_cells;
+
+   // Gracz, który nie osiągnął limitu obszarów, może zająć dowolne pole
+   // innego gracza spełniające warunki. W przeciwnym przypadku pole musi
+   // sąsiadować z jego obszarem.
+   for (uint32_t i = 1; i <= g->players; i++) {
+      array_t *a = &g->arrays[i];
+      a->golden_possible = a->golden_move == 0 &&
+         ((a->num_of_areas < g->areas && all_cells - a->golden_cells > 0) ||
+          a->golden_adjacent);
+   }
+
+   g->golden_valid = true;
+   return true;
 }
- 
+
 bool gamma_golden_possible(gamma_t *g, uint32_t player) {
-      if (g == NULL)
+   if (g == NULL)
       return false;
    // Sprawdzamy, czy golden move dla gracza player jest możliwy. 
-    if (check_player(g, player) && g->arrays[player].golden_move == 0 
-            && g->num_of_busy_fields - g->arrays[player].num_of_fields > 0) {
+   if (check_player(g, player) && g->arrays[player].golden_move == 0 
+       && g->num_of_busy_fields - g->arrays[player].num_of_fields > 0) {
+      if (g->golden_valid || golden_analysis(g))
+         return g->arrays[player].golden_possible;
+
+      // Nie udało się zaalokować pamięci, sprawdzamy każde pole osobno.
+      // Złote ruchy nie zwalniają pól, więc zajęte pola są w tablicy dirty.
+      if (!g->dirty_lost) {
+         for (uint64_t i = 0; i < g->dirty_count; i++) {
+            uint64_t x, y;
+            layout_coords(&g->layout, g->dirty[i], &x, &y);
+            if (gamma_golden_check(g, player, x - 1, y - 1))
+               return true;
+         }
+         return false;
+      }
       for (uint32_t i = 0; i < g->height; i++) {
          for (uint32_t j = 0; j < g->width; j++) {
-            if (gamma_golden_possible_x_y(g, player, j, i)) {
+            if (gamma_golden_check(g, player, j, i)) {
                return true;
             }
          }
@@ -811,61 +1515,131 @@ bool gamma_golden_possible(gamma_t *g, uint32_t player) {
    }
 }
 
-/** @brief  Aktualizuje plansze gdy diff @p player może wykonać złoty ruch
- * na polu @p x i @p y. 
+bool gamma_stats(gamma_t *g, gamma_stats_t *out) {
+   if (g == NULL || out == NULL)
+      return false;
+   // Pierwsze wywołanie gamma_golden_possible wyznacza wyniki analizy
+   // złotych ruchów dla wszystkich graczy, kolejne je odczytują.
+   for (uint32_t i = 1; i <= g->players; i++) {
+      out[i - 1].busy = g->arrays[i].num_of_fields;
+      out[i - 1].free = gamma_free_fields(g, i);
+      out[i - 1].areas = g->arrays[i].num_of_areas;
+      out[i - 1].golden = gamma_golden_possible(g, i);
+   }
+   return true;
+}
+
+/** @brief Szuka w zbiorach tablicy active pierwszego gracza o numerze
+ * z przedziału [@p from, @p to], który może wykonać ruch.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] from    – najmniejszy numer gracza, liczba dodatnia,
+ * @param[in] to      – największy numer gracza, niewiększy od liczby graczy.
+ * @return Zwraca numer gracza lub 0, jeśli żaden z graczy nie może wykonać
+ * ruchu.
+ */
+static uint32_t next_active(gamma_t *g, uint32_t from, uint32_t to) {
+   // Gracze pierwszego zbioru mogą wykonać zwykły ruch, jeśli plansza nie
+   // jest pełna. Złoty ruch sprawdzamy tylko pozostałym graczom drugiego
+   // zbioru.
+   uint64_t mask = g->num_of_busy_fields < (uint64_t)g->width * g->height ?
+                   UINT64_MAX : 0;
+   for (uint64_t w = from / 64; w <= to / 64; w++) {
+      uint64_t movers = g->active[2 * w] & mask;
+      uint64_t bits = movers | g->active[2 * w + 1];
+      if (w == from / 64)
+         bits &= UINT64_MAX << (from % 64);
+      if (w == to / 64 && to % 64 < 63)
+         bits &= ((uint64_t)1 << (to % 64 + 1)) - 1;
+      for (; bits != 0; bits &= bits - 1) {
+         uint32_t player = (uint32_t)(w * 64 + __builtin_ctzll(bits));
+         if ((movers >> (player % 64) & 1) ||
+             gamma_golden_possible(g, player))
+            return player;
+      }
+   }
+   return 0;
+}
+
+uint32_t gamma_next_active_player(gamma_t *g, uint32_t after) {
+   if (g == NULL || after > g->players)
+      return 0;
+   uint32_t player = after < g->players ?
+                     next_active(g, after + 1, g->players) : 0;
+   if (player == 0 && after > 0)
+      player = next_active(g, 1, after);
+   return player;
+}
+
+bool gamma_is_over(gamma_t *g) {
+   if (g == NULL)
+      return true;
+   if (g->movers > 0 &&
+       g->num_of_busy_fields < (uint64_t)g->width * g->height)
+      return false;
+   return gamma_next_active_player(g, 0) == 0;
+}
+
+/** @brief  Aktualizuje plansze gdy gracz @p player może wykonać złoty ruch
+ * na polu @p num.
  * Zmienia stan planszy po wykonaniu przez gracza @p player złotego ruch na 
- * polu @p x i @p y. Aktualizuje stan planszy dla gracza @p player2. 
+ * polu @p num. Aktualizuje stan planszy dla gracza @p player2.
  * Zaznacza wykonanie złotego ruchu przez gracza @p player. 
  * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
  * @param[in] player2  – numer gracza wykonującego, który był właścicielem pola
- *                       @p x i @p y przed złotym ruchem, liczba dodatnia
+ *                       @p num przed złotym ruchem, liczba dodatnia
  *                       niewiększa od wartości @p players z funkcji 
  *                       @ref gamma_new,
  * @param[in] player  – numer gracza wykonującego złoty ruch, liczba dodatnia
  *                      niewiększa od wartości @p players z funkcji 
  *                      @ref gamma_new,
- * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
- *                      @p width z funkcji @ref gamma_new,
- * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
- *                      @p height z funkcji @ref gamma_new,
+ * @param[in] num     – numer pola planszy,
+ * @param[in] nb      – sąsiedztwo pola @p num zebrane dla gracza @p player,
  * @param[in] new_areas - ilość nowopowstałych obszarów, po wyłączeniu pola 
- *                        @p x i @p y z pól gracza nr. @p player2. 
+ *                        @p num z pól gracza nr. @p player2.
  */
 static void golden_move_ok(gamma_t *g, uint32_t player2, uint32_t player, 
-                uint32_t x, uint32_t y, uint32_t new_areas) {
-   // Odejmujemy liczbę wolnych pól sąsiadujących z polem o wsp. x i y
+                uint64_t num, const neighbours_t *nb, uint32_t new_areas) {
+   if (g->journal != NULL)
+      journal_mark(g->journal);
+   // Zwalniamy pole num na czas aktualizacji liczników gracza player2.
+   set_cell(g, num, 0);
+   // Odejmujemy liczbę wolnych pól sąsiadujących z polem num
    // dla gracza, którego pole zostało zajęte przez golden move. 
-   golden_decrease(g, player2, x, y);
+   golden_decrease(g, player2, nb);
    // Zwiększamy liczbę pól zajętych przez gracza wykonującego golden
-   // move i zmniejszamy dla poprzedniego właściciela pola x i y.
+   // move i zmniejszamy dla poprzedniego właściciela pola num.
+   SAVE(g, g->arrays[player].num_of_fields);
+   SAVE(g, g->arrays[player2].num_of_fields);
+   SAVE(g, g->arrays[player2].num_of_areas);
    g->arrays[player].num_of_fields++;
    g->arrays[player2].num_of_fields--; 
    
    // Aktualizujemy liczbę obszarów dla gracza player2. 
-   if (!have_neighbour(g, player2, x, y))
+   if (count_neighbours(g, player2, num) == 0)
       g->arrays[player2].num_of_areas--;
    else 
       g->arrays[player2].num_of_areas += (new_areas - 1);
    
    // Aktualizujemy plansze, numer reprezentanta oraz wielkość 
-   // poszczególnych obszarów. 
-   g->board[y][x] = player;
-   change_rank(g->find_union, numer(g, x, y), 1);
-   change_rep(g->find_union, numer(g, x, y), numer(g, x, y));
+   // poszczególnych obszarów. Odcięte części obszaru gracza player2
+   // dostają nowych reprezentantów.
+   fsplit_apply(g->find_union, num);
+   set_cell(g, num, player);
+   note_move(g, num);
    
-   // Dodajemy liczbę nowych wolnych pól dla gracza x i y sąsiadujących z x i y.
-   increase_neighbour_fields(g, player, x, y);
+   // Dodajemy liczbę nowych wolnych pól dla gracza sąsiadujących z num.
+   increase_neighbour_fields(g, player, nb);
    
    // Aktualizujemy liczbę obszarów dla gracza player. 
-   if (!have_neighbour(g, player, x, y)) {
-      g->arrays[player].num_of_areas++;
-   }
-   else {
-      g->arrays[player].num_of_areas++;
-      link_areas(g, player, x, y); 
-   }
+   SAVE(g, g->arrays[player].num_of_areas);
+   g->arrays[player].num_of_areas++;
+   link_areas(g, player, num, nb);
    
+   SAVE(g, g->arrays[player].golden_move);
    g->arrays[player].golden_move = 1;                            
+   update_active(g, player);
+   update_active(g, player2);
+   g->golden_valid = false;
 }
 
 bool gamma_golden_move(gamma_t *g, uint32_t player, uint32_t x, uint32_t y) {
@@ -874,49 +1648,32 @@ bool gamma_golden_move(gamma_t *g, uint32_t player, uint32_t x, uint32_t y) {
    // Sprawdzamy, czy złoty ruch jest możliwy i czy parametry są poprawne.
    if (check_player(g, player) && check_x_y (g, x, y) && 
        gamma_golden_possible_old(g, player)) {
+      uint64_t num = numer(g, x, y);
       // Sprawdzamy, czy pole nie należy do graczy i czy nie jest wolne.
-      if (g->board[y][x] == player || g->board[y][x] == 0)
+      if (board_get(&g->board, num) == player ||
+          board_get(&g->board, num) == 0)
          return false;
       
       // Ustawiam player2 jako poprzedniego właściciela pola x i y. 
-      uint32_t player2 = g->board[y][x];
-      // c1, c2, c3, c4 - numery globalnego licznika dla nowych wywołań dfs.
+      uint32_t player2 = board_get(&g->board, num);
       // new_areas - ilość nowych obszarów gracza player2 powstałych po
       // zmianie właściciela pola o wsp. x i y. 
-      uint32_t c1 = 1, c2 = 1, c3 = 1, c4 = 1, new_areas = 0; 
-      g->board[y][x] = 0; 
+      uint32_t new_areas;
+      if (!fsplit(g->find_union, &g->board, &g->layout, num, &new_areas))
+         return false;
       
-      if (check_x_y(g, x - 1, y) && start_dfs(g, player2, x - 1, y)) {
-         new_areas++; 
-         c1 = counter; 
-      }
-      if (check_x_y(g, x, y - 1) 
-          && different_num(g->visited[numer(g, x, y - 1)], c1, c2, c3, c4)
-          && start_dfs(g, player2, x, y - 1)) {
-         new_areas++;
-         c2 = counter; 
-      }
-      if (check_x_y(g, x + 1, y) 
-          && different_num(g->visited[numer(g, x + 1, y)], c1, c2, c3, c4)
-          && start_dfs(g, player2, x + 1, y)) {
-         new_areas++;
-         c3 = counter; 
-      }
-      if (check_x_y(g, x, y+1) 
-          && different_num(g->visited[numer(g, x, y+1)], c1, c2, c3, c4) 
-          && start_dfs(g, player2, x, y + 1)) {
-          new_areas++;
-      }
-      // Sprawdzamy, czy golden move może być wykonany, jeśli nie to przywracamy
-      // poprzedni stan planszy. 
+      neighbours_t nb;
+      gather_neighbours(g, player, num, &nb);
+      // Sprawdzamy, czy golden move może być wykonany. 
       if (g->arrays[player2].num_of_areas + new_areas - 1 > g->areas ||
-         (!have_neighbour(g, player, x, y) && 
-          g->arrays[player].num_of_areas + 1 > g->areas)) {
-            golden_move_failed(g, player2, x, y, new_areas);
+         (nb.count == 0 && g->arrays[player].num_of_areas + 1 > g->areas))
             return false; 
-      }
+      // Węzły rozpadu zapewniamy dopiero dla ruchu, który zostanie
+      // wykonany, bo przebudowa struktury czyści dziennik.
+      if (!fsplit_reserve(g->find_union, &g->board, &g->layout))
+         return false;
       
-      golden_move_ok(g, player2, player, x, y, new_areas);
+      golden_move_ok(g, player2, player, num, &nb, new_areas);
       return true; 
    }
    return false;
@@ -941,54 +1698,445 @@ uint64_t gamma_free_fields(gamma_t *g, uint32_t player) {
               - (uint64_t)g->num_of_busy_fields;
 }
 
-char* gamma_board(gamma_t *g) {
-   if (g == NULL)
+uint64_t gamma_legal_moves(gamma_t *g, uint32_t player, uint64_t *out,
+                           uint64_t cap) {
+   if (g == NULL || !check_player(g, player))
+      return 0;
+   // Gracz, który osiągnął limit obszarów, może zająć tylko pola
+   // sąsiadujące z jego obszarami, tak jak w funkcji gamma_move.
+   bool limited = g->arrays[player].num_of_areas == g->areas;
+   uint64_t count = 0;
+
+   for (uint32_t i = 0; i < g->height; i++) {
+      uint64_t num = numer(g, 0, i);
+      for (uint32_t j = 0; j < g->width; j++, num = LAYOUT_NEXT(&g->layout, num)) {
+         if (board_get(&g->board, num) != 0 ||
+             (limited && count_neighbours(g, player, num) == 0))
+            continue;
+         if (count < cap)
+            out[count] = (uint64_t)i * g->width + j;
+         count++;
+      }
+   }
+   return count;
+}
+
+/** @brief Zostawia w masce wolnych pól wiersza tylko pola sąsiadujące
+ * z polami gracza. Sąsiadów z tego samego wiersza wyznaczają przesunięcia
+ * słów maski o jeden bit, z przeniesieniem bitu z sąsiedniego słowa.
+ * @param[in,out] empty – maska wolnych pól wiersza,
+ * @param[in] own     – maski pól gracza w wierszu poprzednim, bieżącym
+ *                      i następnym,
+ * @param[in] words   – liczba słów masek.
+ */
+static void adjacent_row(uint64_t *empty, uint64_t *const *own,
+                         uint64_t words) {
+   const uint64_t *row = own[1];
+   for (uint64_t k = 0; k < words; k++) {
+      uint64_t left = row[k] << 1 | (k > 0 ? row[k - 1] >> 63 : 0);
+      uint64_t right = row[k] >> 1 | (k + 1 < words ? row[k + 1] << 63 : 0);
+      empty[k] &= left | right | own[0][k] | own[2][k];
+   }
+}
+
+/** @brief Dopisuje maskę wiersza do maski planszy od bitu @p pos.
+ * Bity maski wiersza za ostatnim polem muszą być zerami.
+ * @param[in,out] mask – maska planszy,
+ * @param[in] pos     – numer bitu pierwszego pola wiersza,
+ * @param[in] row     – maska wiersza,
+ * @param[in] words   – liczba słów maski wiersza.
+ */
+static void put_row(uint64_t *mask, uint64_t pos, const uint64_t *row,
+                    uint64_t words) {
+   uint64_t *m = mask + pos / 64;
+   uint32_t off = pos % 64;
+   for (uint64_t k = 0; k < words; k++) {
+      m[k] |= row[k] << off;
+      // Bity przeniesione do następnego słowa leżą jeszcze na planszy.
+      if (off != 0 && row[k] >> (64 - off) != 0)
+         m[k + 1] |= row[k] >> (64 - off);
+   }
+}
+
+/** @brief Zapisuje maskę pól wiersza @p row o wartości @p value. Jeśli gra
+ * przechowuje płaszczyzny bitowe, maska jest kopiowana z płaszczyzny,
+ * a w przeciwnym przypadku liczona z planszy. Kolejne pola wiersza mają
+ * kolejne numery tylko w obrębie kafelka, więc przy rozmieszczeniu
+ * kafelkami maska jest składana z kawałków.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] row     – numer wiersza, licząc wiersz ramki pod planszą,
+ * @param[in] value   – numer gracza lub 0 dla pól wolnych,
+ * @param[out] mask   – maska wiersza.
+ */
+static void row_mask(gamma_t *g, uint64_t row, uint32_t value,
+                     uint64_t *mask) {
+   const layout_t *l = &g->layout;
+   uint64_t num = layout_cell(l, 1, row);
+   uint64_t run = layout_run(l, num);
+   if (run >= g->width) {
+      if (g->planes.bits != NULL)
+         planes_row(&g->planes, value, num, g->width, mask);
+      else
+         board_mask(&g->board, num, g->width, value, mask);
+      return;
+   }
+
+   memset(mask, 0, ((uint64_t)g->width + 63) / 64 * sizeof(uint64_t));
+   for (uint64_t x = 0; x < g->width; x += run) {
+      num = layout_cell(l, x + 1, row);
+      run = layout_run(l, num);
+      if (run > g->width - x)
+         run = g->width - x;
+      uint64_t piece;
+      if (g->planes.bits != NULL)
+         planes_row(&g->planes, value, num, run, &piece);
+      else
+         board_mask(&g->board, num, run, value, &piece);
+      put_row(mask, x, &piece, 1);
+   }
+}
+
+bool gamma_legal_moves_mask(gamma_t *g, uint32_t player, uint64_t *mask,
+                            uint64_t words) {
+   if (g == NULL || !check_player(g, player) || mask == NULL)
+      return false;
+   uint64_t cells = (uint64_t)g->width * g->height;
+   if (words < (cells + 63) / 64)
+      return false;
+
+   // Maska wolnych pól wiersza i maski pól gracza w trzech kolejnych
+   // wierszach, od wiersza ramki pod planszą.
+   uint64_t row_words = ((uint64_t)g->width + 63) / 64;
+   uint64_t *rows = malloc(4 * row_words * sizeof(uint64_t));
+   if (check_alloc(rows))
       return false;
-    // Tablica, w której będą zamieniane liczby na znaki. 
-   char digits[UINT32_MAX_NUM_OF_DIGITS];
-   // Zmienna przechowywująca długość wszystkich cyfr plus ilość znkaów
-   // nowej lini, będzie ona służyła jaka rozmiar zwracanej tablicy. 
-   long sum = 0; 
-    
+   uint64_t *empty = rows;
+   uint64_t *own[3] = {rows + row_words, rows + 2 * row_words,
+                       rows + 3 * row_words};
+   bool limited = g->arrays[player].num_of_areas == g->areas;
+
+   memset(mask, 0, (cells + 63) / 64 * sizeof(uint64_t));
+   if (limited) {
+      row_mask(g, 0, player, own[0]);
+      row_mask(g, 1, player, own[1]);
+   }
    for (uint32_t i = 0; i < g->height; i++) {
-      for (uint32_t j = 0; j < g->width; j++) {
-         // Kopiujemy liczbę do tablicy znaków. 
-         int len = sprintf(digits, "%" PRIu32, g->board[i][j]); 
-         // Aktualizujemy wielkość zwracanej tablicy. 
-         sum += len;
-         if (len > 1)
-            sum += 2;
-      }      
-   }
-   sum += g->height; 
-   
-   char *char_board = (char *)calloc(sum + 1, sizeof(char));
-   if (check_alloc(char_board))
-      return NULL;
-   // Zmienna pomocnicza potrzebna do kopiowania liczb znak 
-   // po znaku do zwracanej tablicy znaków.
-   uint64_t k = 0;
-   for (long i = -1 + g->height; i >= 0; i--) {
-      for (long j = 0; j < g->width; j++) {
-         if (g->board[i][j] == 0) {
-            char_board[k] = '.'; k++;
-         }
-         else {
-            int len = sprintf(digits, "%" PRIu32, g->board[i][j]); 
-            if (len > 1) {
-               char_board[k] = ' '; k++; 
-            }
-            for (long s = 0; s < len; s++) {
-               char_board[k] = digits[s]; k++;
-            }
-            if (len > 1) {
-               char_board[k] = ' '; k++; 
-            }
+      row_mask(g, (uint64_t)i + 1, 0, empty);
+      if (limited) {
+         row_mask(g, (uint64_t)i + 2, player, own[2]);
+         adjacent_row(empty, own, row_words);
+         uint64_t *t = own[0];
+         own[0] = own[1];
+         own[1] = own[2];
+         own[2] = t;
+      }
+      put_row(mask, (uint64_t)i * g->width, empty, row_words);
+   }
+   free(rows);
+   return true;
+}
+
+/** @brief Zwraca liczbę cyfr zapisu dziesiętnego liczby @p n.
+ * @param[in] n       – liczba.
+ * @return Zwraca liczbę cyfr, od 1 do 10.
+ */
+static uint32_t num_digits(uint32_t n) {
+   static const uint32_t powers[UINT32_MAX_NUM_OF_DIGITS - 1] = {
+      10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+      1000000000
+   };
+   uint32_t len = 1;
+   while (len < UINT32_MAX_NUM_OF_DIGITS && n >= powers[len - 1])
+      len++;
+   return len;
+}
+
+/** @brief Zwraca liczbę znaków opisu pola o wartości @p player.
+ * Wolne pole opisuje kropka, a pole gracza jego numer, otoczony spacjami,
+ * jeśli ma więcej niż jedną cyfrę.
+ * @param[in] player  – numer gracza lub 0 dla pola wolnego.
+ * @return Zwraca liczbę znaków opisu pola.
+ */
+static uint64_t cell_length(uint32_t player) {
+   uint32_t len = num_digits(player);
+   return len > 1 ? len + 2 : 1;
+}
+
+/** @brief Zapisuje opis pola o wartości @p player od znaku @p out.
+ * Cyfry są zapisywane parami, od końca, z tablicy zapisów liczb od 0 do 99.
+ * @param[out] out    – miejsce na opis pola,
+ * @param[in] player  – numer gracza lub 0 dla pola wolnego.
+ * @return Zwraca wskaźnik na znak za opisem pola.
+ */
+static char *put_cell(char *out, uint32_t player) {
+   static const char pairs[201] =
+      "0001020304050607080910111213141516171819"
+      "2021222324252627282930313233343536373839"
+      "4041424344454647484950515253545556575859"
+      "6061626364656667686970717273747576777879"
+      "8081828384858687888990919293949596979899";
+
+   if (player == 0) {
+      *out = '.';
+      return out + 1;
+   }
+   if (player < 10) {
+      *out = (char)('0' + player);
+      return out + 1;
+   }
+
+   char *end = out + num_digits(player) + 1;
+   char *p = end;
+   *out = ' ';
+   while (player >= 100) {
+      p -= 2;
+      memcpy(p, pairs + 2 * (player % 100), 2);
+      player /= 100;
+   }
+   if (player >= 10) {
+      p -= 2;
+      memcpy(p, pairs + 2 * player, 2);
+   }
+   else {
+      *--p = (char)('0' + player);
+   }
+   *end = ' ';
+   return end + 1;
+}
+
+/** @brief Liczy znaki opisu wierszy od @p from do @p to (bez @p to),
+ * licząc od górnego wiersza planszy, razem ze znakami nowej linii.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] from    – numer pierwszego wiersza opisu,
+ * @param[in] to      – numer wiersza za ostatnim wierszem opisu.
+ * @return Zwraca liczbę znaków.
+ */
+static uint64_t rows_length(gamma_t *g, uint32_t from, uint32_t to) {
+   // Numery graczy mniejsze od 10 mają jedną cyfrę.
+   if (g->players < 10)
+      return (uint64_t)(to - from) * ((uint64_t)g->width + 1);
+
+   uint64_t length = to - from;
+   for (uint32_t r = from; r < to; r++) {
+      uint64_t num = numer(g, 0, g->height - 1 - r);
+      for (uint32_t j = 0; j < g->width; j++, num = LAYOUT_NEXT(&g->layout, num))
+         length += cell_length(board_get(&g->board, num));
+   }
+   return length;
+}
+
+/** @brief Liczy znaki opisu planszy bez kończącego znaku zerowego.
+ * Jeśli graczy jest nie więcej niż pól, korzysta z liczby pól każdego
+ * gracza i nie przechodzi po planszy.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry.
+ * @return Zwraca liczbę znaków.
+ */
+static uint64_t board_length(gamma_t *g) {
+   uint64_t cells = (uint64_t)g->width * g->height;
+   if (g->players > cells)
+      return rows_length(g, 0, g->height);
+
+   // Każdy wiersz kończy znak nowej linii, a każde wolne pole kropka.
+   uint64_t length = g->height + cells - g->num_of_busy_fields;
+   for (uint32_t i = 1; i <= g->players; i++)
+      length += g->arrays[i].num_of_fields * cell_length(i);
+   return length;
+}
+
+/** @brief Zapisuje opis wierszy od @p from do @p to (bez @p to), licząc
+ * od górnego wiersza planszy, od znaku @p out.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[out] out    – miejsce na opis wierszy,
+ * @param[in] from    – numer pierwszego wiersza opisu,
+ * @param[in] to      – numer wiersza za ostatnim wierszem opisu.
+ */
+static void render_rows(gamma_t *g, char *out, uint32_t from, uint32_t to) {
+   // Numery graczy mniejsze od 10 mają jedną cyfrę, więc opis pola
+   // bierzemy z tablicy, bez rozgałęzień.
+   static const char single[10] = {'.', '1', '2', '3', '4', '5', '6', '7',
+                                   '8', '9'};
+   for (uint32_t r = from; r < to; r++) {
+      uint64_t num = numer(g, 0, g->height - 1 - r);
+      if (g->players < 10) {
+         for (uint32_t j = 0; j < g->width; j++, num = LAYOUT_NEXT(&g->layout, num))
+            out[j] = single[board_get(&g->board, num)];
+         out += g->width;
+      }
+      else {
+         for (uint32_t j = 0; j < g->width; j++, num = LAYOUT_NEXT(&g->layout, num))
+            out = put_cell(out, board_get(&g->board, num));
+      }
+      *out++ = '\n';
+   }
+}
+
+/**
+ * Struktura opisująca część wierszy planszy wypisywaną przez jeden wątek.
+ */
+typedef struct render_s render_t;
+
+/**
+ * Struktura opisująca część wierszy planszy wypisywaną przez jeden wątek.
+ */
+struct render_s {
+   gamma_t *g;                 /**< Wypisywana gra. */
+   char *out;                  /**< Miejsce na opis wierszy. */
+   uint64_t length;            /**< Liczba znaków opisu wierszy. */
+   uint32_t from;              /**< Pierwszy wiersz części. */
+   uint32_t to;                /**< Wiersz za ostatnim wierszem części. */
+};
+
+/** @brief Liczy znaki opisu części wierszy.
+ * @param[in,out] arg – wskaźnik na strukturę @ref render_s.
+ * @return Zwraca NULL.
+ */
+static void *length_job(void *arg) {
+   render_t *r = arg;
+   r->length = rows_length(r->g, r->from, r->to);
+   return NULL;
+}
+
+/** @brief Zapisuje opis części wierszy.
+ * @param[in,out] arg – wskaźnik na strukturę @ref render_s.
+ * @return Zwraca NULL.
+ */
+static void *render_job(void *arg) {
+   render_t *r = arg;
+   render_rows(r->g, r->out, r->from, r->to);
+   return NULL;
+}
+
+/** @brief Wykonuje funkcję @p job dla każdej z @p count części, każdą
+ * w osobnym wątku. Pierwszą część i części, dla których nie udało się
+ * utworzyć wątku, wykonuje wątek wywołujący.
+ * @param[in,out] parts – części wierszy,
+ * @param[in] count   – liczba części,
+ * @param[in] job     – funkcja wykonywana dla części.
+ */
+static void run_parts(render_t *parts, uint32_t count,
+                      void *(*job)(void *)) {
+   pthread_t threads[RENDER_MAX_THREADS];
+   bool started[RENDER_MAX_THREADS] = {false};
+
+   for (uint32_t i = 1; i < count; i++)
+      started[i] = pthread_create(&threads[i], NULL, job, &parts[i]) == 0;
+   job(&parts[0]);
+   for (uint32_t i = 1; i < count; i++) {
+      if (started[i])
+         pthread_join(threads[i], NULL);
+      else
+         job(&parts[i]);
+   }
+}
+
+/** @brief Zwraca liczbę wątków wypisujących planszę.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry.
+ * @return Zwraca 1 dla plansz mniejszych niż @ref RENDER_PARALLEL_CELLS
+ * pól, a dla większych liczbę procesorów, nie większą od
+ * @ref RENDER_MAX_THREADS i liczby wierszy.
+ */
+static uint32_t render_threads(gamma_t *g) {
+   if ((uint64_t)g->width * g->height < RENDER_PARALLEL_CELLS)
+      return 1;
+   long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   uint32_t threads = cpus < 1 ? 1 : (uint32_t)cpus;
+   if (threads > RENDER_MAX_THREADS)
+      threads = RENDER_MAX_THREADS;
+   return threads < g->height ? threads : g->height;
+}
+
+/** @brief Zapisuje opis planszy od znaku @p out.
+ * Duże plansze dzieli na części o równej liczbie wierszy, wypisywane przez
+ * osobne wątki. Początek każdej części wyznacza liczba znaków opisu
+ * poprzednich części.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[out] out    – miejsce na opis planszy.
+ */
+static void render_board(gamma_t *g, char *out) {
+   uint32_t count = render_threads(g);
+   if (count == 1) {
+      render_rows(g, out, 0, g->height);
+      return;
+   }
+
+   render_t parts[RENDER_MAX_THREADS];
+   for (uint32_t i = 0; i < count; i++) {
+      parts[i].g = g;
+      parts[i].from = (uint32_t)((uint64_t)g->height * i / count);
+      parts[i].to = (uint32_t)((uint64_t)g->height * (i + 1) / count);
+   }
+   run_parts(parts, count, length_job);
+   for (uint32_t i = 0; i < count; i++) {
+      parts[i].out = out;
+      out += parts[i].length;
+   }
+   run_parts(parts, count, render_job);
+}
+
+uint64_t gamma_board_into(gamma_t *g, char *buf, uint64_t cap) {
+   if (g == NULL)
+      return 0;
+
+   uint64_t length = board_length(g) + 1;
+   if (buf != NULL && cap >= length) {
+      render_board(g, buf);
+      buf[length - 1] = '\0';
+   }
+   return length;
+}
+
+uint64_t gamma_version(gamma_t *g) {
+   return g == NULL ? 0 : g->version;
+}
+
+uint64_t gamma_changes_since(gamma_t *g, uint64_t token, uint64_t *out,
+                             uint64_t cap) {
+   if (g == NULL || token > g->version || token < g->changes_from ||
+       g->version - token > CHANGES_SIZE)
+      return GAMMA_CHANGES_LOST;
+
+   uint64_t count = g->version - token;
+   for (uint64_t i = 0; i < count && i < cap; i++) {
+      uint64_t x, y;
+      layout_coords(&g->layout, g->changes[(token + i) % CHANGES_SIZE], &x, &y);
+      out[i] = (y - 1) * g->width + x - 1;
+   }
+   return count;
+}
+
+bool gamma_board_write(gamma_t *g, gamma_sink_t sink, void *ctx) {
+   if (g == NULL || sink == NULL)
+      return false;
+
+   char chunk[RENDER_CHUNK];
+   char *out = chunk;
+   for (uint32_t r = 0; r < g->height; r++) {
+      uint64_t num = numer(g, 0, g->height - 1 - r);
+      // Ostatnim znakiem wiersza jest znak nowej linii.
+      for (uint32_t j = 0; j <= g->width; j++, num = LAYOUT_NEXT(&g->layout, num)) {
+         if (chunk + RENDER_CHUNK - out < MAX_CELL_TEXT) {
+            if (!sink(ctx, chunk, out - chunk))
+               return false;
+            out = chunk;
          }
+         if (j < g->width)
+            out = put_cell(out, board_get(&g->board, num));
+         else
+            *out++ = '\n';
       }
-      char_board[k] = '\n'; k++;
    }
-   char_board[k] = '\0';
+   return out == chunk || sink(ctx, chunk, out - chunk);
+}
+
+char* gamma_board(gamma_t *g) {
+   if (g == NULL)
+      return NULL;
+
+   uint64_t length = gamma_board_into(g, NULL, 0);
+   char *char_board = malloc(length);
+   if (check_alloc(char_board))
+      return NULL;
+   gamma_board_into(g, char_board, length);
    return char_board;
 }
 
@@ -998,5 +2146,5 @@ uint64_t gamma_all_free_fields(gamma_t *g) {
 }
 
 uint32_t gamma_give_player(gamma_t *g, uint32_t x, uint32_t y) {
-   return g->board[y][x];
+   return board_get(&g->board, numer(g, x, y));
 }
@@ -1,6 +1,15 @@
 /** @file
  * Interfejs klasy przechowującej stan gry gamma
  *
+ * Cały stan silnika jest przechowywany w strukturze @ref gamma_t, a silnik
+ * nie używa zmiennych globalnych. Różne struktury @ref gamma_t mogą być
+ * jednocześnie używane przez różne wątki bez synchronizacji. Jedna
+ * struktura nie może być używana jednocześnie przez wiele wątków, także
+ * przez funkcje, które jej nie zmieniają, bo zapisują one pomocnicze dane
+ * w strukturze. Wyjątkiem jest funkcja @ref gamma_golden_check, którą
+ * wiele wątków może wywoływać jednocześnie dla gry, której nikt w tym
+ * czasie nie zmienia.
+ *
  * @author Marcin Peczarski <marpe@mimuw.edu.pl>
  * @copyright Uniwersytet Warszawski
  * @date 18.03.2020
@@ -10,6 +19,7 @@
 #define GAMMA_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -20,6 +30,13 @@ typedef struct gamma gamma_t;
 /** @brief Tworzy strukturę przechowującą staan gry.
  * Alokuje pamięć na nową strukturę przechowującą stan gry.
  * Inicjuje tę strukturę tak, aby reprezentowała początkowy stan gry.
+ * Zapisuje przy tym tylko pola ramki planszy; pozostała pamięć jest
+ * przydzielana przez system przy pierwszym zapisie, więc koszt utworzenia
+ * gry zależy od obwodu planszy, a nie od jej pola.
+ * Gdy tablice całej planszy nie mieszczą się w pamięci, gra przechowuje
+ * tylko zajęte pola, więc jej pamięć rośnie z liczbą wykonanych ruchów,
+ * a nie z wielkością planszy.
+ * Taka gra nie pozwala cofać ruchów ani zapisywać stanu do pliku.
  * @param[in] width   – szerokość planszy, liczba dodatnia,
  * @param[in] height  – wysokość planszy, liczba dodatnia,
  * @param[in] players – liczba graczy, liczba dodatnia,
@@ -68,6 +85,26 @@ bool gamma_move(gamma_t *g, uint32_t player, uint32_t x, uint32_t y);
  */
 bool gamma_golden_move(gamma_t *g, uint32_t player, uint32_t x, uint32_t y);
 
+/** @brief Sprawdza, czy złoty ruch jest możliwy.
+ * Sprawdza, czy gracz @p player może wykonać złoty ruch na polu
+ * (@p x, @p y), tak jak zrobiłaby to funkcja @ref gamma_golden_move, ale
+ * nie zmienia planszy, obszarów ani liczników gry. Pamięć pomocniczą
+ * przydziela dla siebie, więc można ją wywoływać dla gry, której nikt
+ * w tym czasie nie zmienia, z kilku wątków.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
+ *                      @p players z funkcji @ref gamma_new,
+ * @param[in] x       – numer kolumny, liczba nieujemna mniejsza od wartości
+ *                      @p width z funkcji @ref gamma_new,
+ * @param[in] y       – numer wiersza, liczba nieujemna mniejsza od wartości
+ *                      @p height z funkcji @ref gamma_new.
+ * @return Wartość @p true, jeśli złoty ruch zostałby wykonany, a @p false,
+ * gdy ruch jest nielegalny, któryś z parametrów jest niepoprawny lub nie
+ * udało się zaalokować pamięci.
+ */
+bool gamma_golden_check(const gamma_t *g, uint32_t player,
+                        uint32_t x, uint32_t y);
+
 /** @brief Podaje liczbę pól zajętych przez gracza.
  * Podaje liczbę pól zajętych przez gracza @p player.
  * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
@@ -89,6 +126,42 @@ uint64_t gamma_busy_fields(gamma_t *g, uint32_t player);
  */
 uint64_t gamma_free_fields(gamma_t *g, uint32_t player);
 
+/** @brief Wyznacza pola, na których gracz może wykonać ruch.
+ * Zapisuje w tablicy @p out numery pól, na których gracz @p player może
+ * w danym stanie gry wykonać ruch funkcją @ref gamma_move. Pole
+ * o współrzędnych (x, y) ma numer y * width + x, a numery są zapisywane
+ * rosnąco.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
+ *                      @p players z funkcji @ref gamma_new,
+ * @param[out] out    – tablica na numery pól, może mieć wartość NULL, jeśli
+ *                      @p cap jest zerem,
+ * @param[in] cap     – pojemność tablicy @p out; funkcja zapisuje co najwyżej
+ *                      tyle numerów.
+ * @return Liczba wszystkich pól, na których gracz może wykonać ruch, także
+ * tych, które nie zmieściły się w tablicy @p out, lub zero, jeśli któryś
+ * z parametrów jest niepoprawny.
+ */
+uint64_t gamma_legal_moves(gamma_t *g, uint32_t player, uint64_t *out,
+                           uint64_t cap);
+
+/** @brief Wyznacza maskę pól, na których gracz może wykonać ruch.
+ * Bit o numerze y * width + x maski (bit o numerze k to bit k % 64 słowa
+ * k / 64) jest ustawiony wtedy i tylko wtedy, gdy gracz @p player może
+ * wykonać ruch na polu (x, y). Maska jest liczona wierszami, po 64 pola
+ * na słowo, więc kosztuje kilka przejść po planszy.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] player  – numer gracza, liczba dodatnia niewiększa od wartości
+ *                      @p players z funkcji @ref gamma_new,
+ * @param[out] mask   – tablica na maskę,
+ * @param[in] words   – liczba słów tablicy @p mask, co najmniej
+ *                      (width * height + 63) / 64.
+ * @return Wartość @p true, jeśli maska została wyznaczona, a @p false, gdy
+ * nie udało się zaalokować pamięci lub któryś z parametrów jest niepoprawny.
+ */
+bool gamma_legal_moves_mask(gamma_t *g, uint32_t player, uint64_t *mask,
+                            uint64_t words);
+
 /** @brief Sprawdza, czy gracz może wykonać złoty ruch.
  * Sprawdza, czy gracz @p player jeszcze nie wykonał w tej rozgrywce złotego
  * ruchu i ma możliwość wykonania złotego ruchu na planszy.
@@ -101,6 +174,61 @@ uint64_t gamma_free_fields(gamma_t *g, uint32_t player);
  */
 bool gamma_golden_possible(gamma_t *g, uint32_t player);
 
+/**
+ * Struktura opisująca stan jednego gracza.
+ */
+typedef struct gamma_stats gamma_stats_t;
+
+/**
+ * Struktura opisująca stan jednego gracza.
+ */
+struct gamma_stats {
+   uint64_t busy;              /**< Wynik funkcji @ref gamma_busy_fields. */
+   uint64_t free;              /**< Wynik funkcji @ref gamma_free_fields. */
+   uint32_t areas;             /**< Liczba obszarów gracza. */
+   bool golden;                /**< Wynik funkcji
+                                    @ref gamma_golden_possible. */
+};
+
+/** @brief Podaje stan wszystkich graczy.
+ * Wypełnia tablicę @p out tymi samymi wartościami, które dla każdego gracza
+ * zwróciłyby funkcje @ref gamma_busy_fields, @ref gamma_free_fields
+ * i @ref gamma_golden_possible, oraz liczbą jego obszarów. Możliwość
+ * złotego ruchu wyznacza dla wszystkich graczy jednym przejściem po
+ * planszy.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[out] out    – tablica o długości równej wartości @p players
+ *                      z funkcji @ref gamma_new; element out[i] opisuje
+ *                      gracza i + 1.
+ * @return Wartość @p true, jeśli tablica została wypełniona, a @p false,
+ * gdy któryś z parametrów jest niepoprawny.
+ */
+bool gamma_stats(gamma_t *g, gamma_stats_t *out);
+
+/** @brief Podaje następnego gracza, który może wykonać ruch.
+ * Gra przechowuje zbiór graczy mających wolne pola, uaktualniany przez
+ * funkcje @ref gamma_move i @ref gamma_golden_move, więc nie sprawdza
+ * każdego gracza osobno. Możliwość złotego ruchu sprawdza tylko graczom
+ * bez wolnych pól.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] after   – numer gracza, po którym szukamy następnego, lub 0,
+ *                      aby zacząć od gracza 1.
+ * @return Numer pierwszego gracza, licząc cyklicznie od gracza
+ * @p after + 1 do gracza @p after włącznie, dla którego funkcja
+ * @ref gamma_free_fields zwraca liczbę dodatnią lub funkcja
+ * @ref gamma_golden_possible zwraca @p true. Zwraca 0, jeśli takiego gracza
+ * nie ma lub któryś z parametrów jest niepoprawny.
+ */
+uint32_t gamma_next_active_player(gamma_t *g, uint32_t after);
+
+/** @brief Sprawdza, czy gra się skończyła.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry.
+ * @return Wartość @p true, jeśli żaden gracz nie może wykonać zwykłego ani
+ * złotego ruchu lub parametr jest niepoprawny, a @p false w przeciwnym
+ * przypadku.
+ */
+bool gamma_is_over(gamma_t *g);
+
 /** @brief Daje napis opisujący stan planszy.
  * Alokuje w pamięci bufor, w którym umieszcza napis zawierający tekstowy
  * opis aktualnego stanu planszy. Przykład znajduje się w pliku gamma_test.c.
@@ -111,6 +239,75 @@ bool gamma_golden_possible(gamma_t *g, uint32_t player);
  */
 char* gamma_board(gamma_t *g);
 
+/** @brief Zapisuje napis opisujący stan planszy w buforze @p buf.
+ * Napis jest taki sam jak napis funkcji @ref gamma_board, ale nie wymaga
+ * alokacji pamięci, więc jeden bufor można wykorzystywać przy kolejnych
+ * wypisaniach planszy. Duże plansze są wypisywane przez kilka wątków.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[out] buf    – bufor na napis lub NULL,
+ * @param[in] cap     – wielkość bufora w bajtach.
+ * @return Liczba bajtów napisu razem z kończącym znakiem zerowym lub zero,
+ * jeśli parametr @p g jest niepoprawny. Napis jest zapisywany tylko wtedy,
+ * gdy @p buf nie jest NULL, a @p cap jest niemniejsze od zwracanej
+ * wartości.
+ */
+uint64_t gamma_board_into(gamma_t *g, char *buf, uint64_t cap);
+
+/**
+ * Wartość zwracana przez @ref gamma_changes_since, gdy zmiany od podanej
+ * wersji nie są znane i trzeba odczytać całą planszę.
+ */
+#define GAMMA_CHANGES_LOST UINT64_MAX
+
+/** @brief Podaje bieżącą wersję planszy.
+ * Wersja rośnie przy każdej zmianie pola planszy, także przy cofnięciu
+ * ruchu, wyczyszczeniu planszy i skopiowaniu do niej innej gry.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry.
+ * @return Wersja planszy lub zero, jeśli parametr jest niepoprawny.
+ */
+uint64_t gamma_version(gamma_t *g);
+
+/** @brief Podaje pola zmienione od wersji @p token.
+ * Zapisuje w tablicy @p out numery pól zmienionych od chwili, gdy
+ * @ref gamma_version zwróciło @p token, w kolejności zmian. Pole
+ * o współrzędnych (x, y) ma numer y * width + x, a pole zmienione kilka
+ * razy występuje kilka razy. Gra pamięta kilka tysięcy ostatnich zmian,
+ * więc odświeżenie planszy kosztuje tyle, ile zmian, a nie pól.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] token   – wersja zwrócona wcześniej przez @ref gamma_version,
+ * @param[out] out    – tablica na numery pól, może mieć wartość NULL, jeśli
+ *                      @p cap jest zerem,
+ * @param[in] cap     – pojemność tablicy @p out.
+ * @return Liczba zmian od wersji @p token, także tych, które nie zmieściły
+ * się w tablicy @p out, lub @ref GAMMA_CHANGES_LOST, jeśli zmiany nie są
+ * znane, bo jest ich za dużo, plansza została wyczyszczona lub
+ * skopiowana, albo któryś z parametrów jest niepoprawny.
+ */
+uint64_t gamma_changes_since(gamma_t *g, uint64_t token, uint64_t *out,
+                             uint64_t cap);
+
+/**
+ * Typ funkcji odbierającej kolejne części napisu opisującego stan planszy.
+ * Dostaje wskaźnik @p ctx przekazany do @ref gamma_board_write, część napisu
+ * (bez kończącego znaku zerowego) i jej długość. Zwraca false, aby przerwać
+ * wypisywanie.
+ */
+typedef bool (*gamma_sink_t)(void *ctx, const char *data, size_t length);
+
+/** @brief Przekazuje napis opisujący stan planszy częściami.
+ * Napis jest taki sam jak napis funkcji @ref gamma_board, ale jest
+ * tworzony wierszami od górnego w buforze stałej wielkości i przekazywany
+ * funkcji @p sink za każdym razem, gdy bufor się zapełni, więc wypisanie
+ * dowolnie dużej planszy nie alokuje pamięci.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] sink    – funkcja odbierająca części napisu,
+ * @param[in] ctx     – wskaźnik przekazywany funkcji @p sink.
+ * @return Wartość @p true, jeśli cały napis został przekazany, a @p false,
+ * gdy funkcja @p sink przerwała wypisywanie lub któryś z parametrów jest
+ * niepoprawny.
+ */
+bool gamma_board_write(gamma_t *g, gamma_sink_t sink, void *ctx);
+
 /// Od tego miejsca autorem pliku jest Jakub Bedełek.
 
 /** @brief Zwraca liczbę wolnych pól na mapie.
@@ -127,6 +324,94 @@ uint64_t gamma_all_free_fields(gamma_t *g);
  */
 uint32_t gamma_give_player(gamma_t *g, uint32_t x, uint32_t y);
 
+/** @brief Przywraca początkowy stan gry.
+ * Po wywołaniu struktura @p g opisuje grę taką, jaką zwróciłaby funkcja
+ * @ref gamma_new z tymi samymi parametrami, bez ponownej alokacji pamięci.
+ * Czyści tylko pola zajęte w poprzedniej grze, więc działa w czasie
+ * proporcjonalnym do ich liczby i liczby graczy. Nic nie robi, jeśli
+ * wskaźnik @p g ma wartość NULL.
+ * @param[in,out] g - wskaźnik na strukturę przechowującą stan gry.
+ */
+void gamma_reset(gamma_t *g);
+
+/** @brief Tworzy kopię stanu gry.
+ * Kopia jest niezależna od oryginału i usuwa się ją funkcją
+ * @ref gamma_delete.
+ * @param[in] src   - wskaźnik na kopiowaną strukturę.
+ * @return Wskaźnik na kopię lub NULL, gdy nie udało się zaalokować pamięci
+ * lub wskaźnik @p src ma wartość NULL.
+ */
+gamma_t *gamma_clone(const gamma_t *src);
+
+/** @brief Kopiuje stan gry @p src do istniejącej struktury @p dst.
+ * Wykorzystuje pamięć struktury @p dst, więc obie gry muszą mieć te same
+ * wymiary planszy i liczbę graczy.
+ * @param[in,out] dst - wskaźnik na strukturę, do której kopiujemy,
+ * @param[in] src     - wskaźnik na kopiowaną strukturę.
+ * @return Wartość @p true, jeśli stan został skopiowany, a @p false, gdy
+ * któryś ze wskaźników ma wartość NULL, gry mają różne wymiary, liczbę
+ * graczy lub tylko jedna z nich przechowuje tylko zajęte pola albo nie
+ * udało się zaalokować pamięci. W ostatnim
+ * przypadku gra @p dst jest czyszczona jak przez @ref gamma_reset.
+ */
+bool gamma_clone_into(gamma_t *dst, const gamma_t *src);
+
+/** @brief Włącza lub wyłącza możliwość cofania ruchów.
+ * Gdy cofanie jest włączone, każdy wykonany ruch i złoty ruch zapisuje
+ * w dzienniku poprzednie wartości zmienianych pól, a struktura find_union
+ * nie skraca ścieżek, dzięki czemu zapis ruchu zajmuje kilkadziesiąt bajtów.
+ * Dziennik jest czyszczony przez @ref gamma_reset, @ref gamma_clone_into
+ * i rzadkie przebudowy struktury find_union po wielu złotych ruchach.
+ * Przebudowę może wywołać tylko wykonany złoty ruch, więc ruchy odrzucone
+ * nie czyszczą dziennika.
+ * Kopia utworzona przez @ref gamma_clone ma cofanie wyłączone.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] enabled – wartość true, aby włączyć cofanie, lub false,
+ *                      aby je wyłączyć i usunąć dziennik.
+ * @return Wartość @p true, jeśli ustawienie zostało zmienione, a @p false,
+ * gdy nie udało się zaalokować pamięci, parametr jest niepoprawny lub gra
+ * przechowuje tylko zajęte pola planszy.
+ */
+bool gamma_set_undo(gamma_t *g, bool enabled);
+
+/** @brief Cofa ostatni ruch zapisany w dzienniku.
+ * Przywraca stan gry sprzed ostatniego wykonanego ruchu lub złotego ruchu.
+ * Kolejne wywołania cofają kolejne ruchy, aż do włączenia cofania lub
+ * wyczyszczenia dziennika.
+ * @param[in,out] g   – wskaźnik na strukturę przechowującą stan gry.
+ * @return Wartość @p true, jeśli ruch został cofnięty, a @p false, gdy
+ * cofanie jest wyłączone, w dzienniku nie ma ruchów lub parametr jest
+ * niepoprawny.
+ */
+bool gamma_undo(gamma_t *g);
+
+/** @brief Zapisuje stan gry do pliku.
+ * Zapisuje do deskryptora pliku @p fd planszę, liczniki graczy i obszary
+ * w formacie binarnym z numerem wersji, z liczbami w kolejności bajtów
+ * little-endian. Dziennik ruchów i wyniki analizy złotych ruchów nie są
+ * zapisywane. Zapis można odczytać tylko w grze skompilowanej z tym samym
+ * rozmieszczeniem pól planszy.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] fd      – deskryptor pliku otwartego do zapisu.
+ * @return Wartość @p true, jeśli stan gry został zapisany, a @p false, gdy
+ * wystąpił błąd zapisu, któryś z parametrów jest niepoprawny lub gra
+ * przechowuje tylko zajęte pola planszy.
+ */
+bool gamma_save(gamma_t *g, int fd);
+
+/** @brief Odczytuje stan gry zapisany funkcją @ref gamma_save.
+ * Odczytuje planszę, liczniki i obszary bez przeliczania ich, więc koszt
+ * odczytu jest proporcjonalny do wielkości zapisu. Sprawdza tylko, czy
+ * odczytane numery pól, graczy i węzłów mieszczą się w tablicach gry.
+ * Odczytana gra ma cofanie ruchów wyłączone.
+ * @param[in] fd      – deskryptor pliku otwartego do odczytu, ustawiony na
+ *                      początku zapisu.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ * zaalokować pamięci, wystąpił błąd odczytu lub zapis jest niepoprawny.
+ * Usuwa się ją funkcją @ref gamma_delete.
+ */
+gamma_t *gamma_load(int fd);
+
 /// Stała przydatna w plikach gamma.c i inter.c.
 /**
  * Stała przechowywująca maksymalną ilość cyfr liczby z zakresu uint32_t.
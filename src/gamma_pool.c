@@ -0,0 +1,76 @@
+/** @file
+ * Implementacja interfejsu puli struktur przechowujących stan gry gamma.
+ *
+ * @author Jakub Bedełek
+ */
+
+#include <stdlib.h>
+#include "gamma_pool.h"
+
+/**
+ * Struktura przechowująca pulę struktur stanu gry.
+ */
+struct gamma_pool {
+   uint32_t width;              /**< Szerokość planszy. */
+   uint32_t height;             /**< Wysokość planszy. */
+   uint32_t players;            /**< Liczba graczy. */
+   uint32_t areas;              /**< Maksymalna liczba obszarów. */
+   gamma_t **games;             /**< Struktury gotowe do wydania. */
+   uint64_t count;              /**< Liczba struktur w tablicy games. */
+   uint64_t size;               /**< Pojemność tablicy games. */
+};
+
+gamma_pool_t *gamma_pool_new(uint32_t width, uint32_t height,
+                             uint32_t players, uint32_t areas) {
+   gamma_pool_t *p = malloc(sizeof(gamma_pool_t));
+   if (p == NULL)
+      return NULL;
+
+   p->width = width;
+   p->height = height;
+   p->players = players;
+   p->areas = areas;
+   p->games = NULL;
+   p->count = p->size = 0;
+   return p;
+}
+
+gamma_t *gamma_pool_get(gamma_pool_t *p) {
+   if (p == NULL)
+      return NULL;
+   if (p->count > 0)
+      return p->games[--p->count];
+   return gamma_new(p->width, p->height, p->players, p->areas);
+}
+
+void gamma_pool_put(gamma_pool_t *p, gamma_t *g) {
+   if (g == NULL)
+      return;
+   if (p == NULL) {
+      gamma_delete(g);
+      return;
+   }
+
+   if (p->count == p->size) {
+      uint64_t new_size = p->size < 16 ? 16 : 2 * p->size;
+      gamma_t **games = realloc(p->games, new_size * sizeof(gamma_t *));
+      if (games == NULL) {
+         gamma_delete(g);
+         return;
+      }
+      p->games = games;
+      p->size = new_size;
+   }
+
+   gamma_reset(g);
+   p->games[p->count++] = g;
+}
+
+void gamma_pool_delete(gamma_pool_t *p) {
+   if (p != NULL) {
+      for (uint64_t i = 0; i < p->count; i++)
+         gamma_delete(p->games[i]);
+      free(p->games);
+      free(p);
+   }
+}
@@ -0,0 +1,58 @@
+/** @file
+ * Interfejs puli struktur przechowujących stan gry gamma o tych samych
+ * parametrach.
+ *
+ * Pula przechowuje struktury zwrócone po zakończeniu gry i wydaje je
+ * ponownie po wyczyszczeniu funkcją @ref gamma_reset, dzięki czemu kolejne
+ * gry nie alokują pamięci. Jedna pula nie może być używana jednocześnie
+ * przez wiele wątków.
+ *
+ * @author Jakub Bedełek
+ */
+
+#ifndef GAMMA_POOL_H
+#define GAMMA_POOL_H
+
+#include <stdint.h>
+#include "gamma.h"
+
+/**
+ * Struktura przechowująca pulę struktur stanu gry.
+ */
+typedef struct gamma_pool gamma_pool_t;
+
+/** @brief Tworzy pustą pulę struktur stanu gry o podanych parametrach.
+ * @param[in] width   – szerokość planszy, liczba dodatnia,
+ * @param[in] height  – wysokość planszy, liczba dodatnia,
+ * @param[in] players – liczba graczy, liczba dodatnia,
+ * @param[in] areas   – maksymalna liczba obszarów,
+ *                      jakie może zająć jeden gracz, liczba dodatnia.
+ * @return Wskaźnik na utworzoną pulę lub NULL, gdy nie udało się
+ * zaalokować pamięci.
+ */
+gamma_pool_t *gamma_pool_new(uint32_t width, uint32_t height,
+                             uint32_t players, uint32_t areas);
+
+/** @brief Wydaje strukturę przechowującą początkowy stan gry.
+ * Jeśli pula jest pusta, tworzy nową strukturę funkcją @ref gamma_new.
+ * @param[in,out] p   – wskaźnik na pulę.
+ * @return Wskaźnik na strukturę lub NULL, gdy nie udało się zaalokować
+ * pamięci lub parametry puli są niepoprawne.
+ */
+gamma_t *gamma_pool_get(gamma_pool_t *p);
+
+/** @brief Zwraca do puli strukturę wydaną przez @ref gamma_pool_get.
+ * Czyści strukturę funkcją @ref gamma_reset. Jeśli nie uda się jej
+ * zapamiętać, usuwa ją. Nic nie robi, jeśli @p g ma wartość NULL.
+ * @param[in,out] p   – wskaźnik na pulę,
+ * @param[in] g       – wskaźnik na strukturę.
+ */
+void gamma_pool_put(gamma_pool_t *p, gamma_t *g);
+
+/** @brief Usuwa pulę i wszystkie przechowywane w niej struktury.
+ * Nic nie robi, jeśli wskaźnik @p p ma wartość NULL.
+ * @param[in] p       – wskaźnik na pulę.
+ */
+void gamma_pool_delete(gamma_pool_t *p);
+
+#endif /* GAMMA_POOL_H */
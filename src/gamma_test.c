@@ -9,9 +9,99 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include "board.h"
 #include "gamma.h"
+#include "gamma_pool.h"
+#include "planes.h"
+
+/** @brief Dopisuje część opisu planszy do napisu @p ctx.
+ * @param[in,out] ctx – napis zakończony znakiem zerowym,
+ * @param[in] data    – część opisu planszy,
+ * @param[in] length  – liczba znaków części.
+ * @return Zwraca true.
+ */
+static bool append(void *ctx, const char *data, size_t length) {
+   strncat(ctx, data, length);
+   return true;
+}
+
+/** @brief Porównuje liczniki wolnych pól sąsiadujących z polami graczy,
+ * którzy osiągnęli limit obszarów, z liczbą wyznaczoną na płaszczyznach
+ * bitowych planszy odtworzonej z napisu funkcji @ref gamma_board.
+ * @param[in] g       – wskaźnik na strukturę przechowującą stan gry,
+ * @param[in] width   – szerokość planszy,
+ * @param[in] height  – wysokość planszy,
+ * @param[in] players – liczba graczy, mniejsza od 10,
+ * @param[in] areas   – maksymalna liczba obszarów.
+ */
+static void check_frontier(gamma_t *g, uint32_t width, uint32_t height,
+                           uint32_t players, uint32_t areas) {
+   // Płaszczyzny liczą sąsiadów tylko przy numeracji pól wierszami.
+   if (!LAYOUT_ROW_MAJOR)
+      return;
+   layout_t l;
+   board_t b;
+   planes_t planes;
+   assert(layout_init(&l, width + 2, height + 2));
+   void *cells = calloc(l.size, board_cell_bytes(players));
+   void *bits = calloc(planes_bytes(l.size, players), 1);
+   assert(cells != NULL && bits != NULL);
+   board_init(&b, cells, players);
+
+   char *p = gamma_board(g);
+   assert(p != NULL);
+   for (uint64_t y = 0; y < l.rows; y++) {
+      for (uint64_t x = 0; x < l.columns; x++) {
+         uint32_t val = b.border;
+         if (x > 0 && y > 0 && x <= width && y <= height) {
+            char c = p[(height - y) * (width + 1) + x - 1];
+            val = c == '.' ? 0 : (uint32_t)(c - '0');
+         }
+         board_set(&b, layout_cell(&l, x, y), val);
+      }
+   }
+   free(p);
+   planes_init(&planes, bits, l.size, players);
+   planes_fill(&planes, &b, l.size);
+
+   gamma_stats_t stats[9];
+   assert(gamma_stats(g, stats));
+   for (uint32_t i = 1; i <= players; i++) {
+      if (stats[i - 1].areas == areas)
+         assert(stats[i - 1].free == planes_frontier(&planes, i, l.columns));
+   }
+   free(cells);
+   free(bits);
+}
+
+/** @brief Odczytuje stan gry z zapisu @p data, w którym liczbę o numerze
+ * bajtu @p offset zastąpiono wartością @p value.
+ * @param[in] data    – zapis stanu gry,
+ * @param[in] length  – długość zapisu w bajtach,
+ * @param[in] offset  – numer pierwszego bajtu liczby uint64_t,
+ * @param[in] value   – nowa wartość liczby.
+ * @return Zwraca odczytaną grę lub NULL.
+ */
+static gamma_t *load_patched(const unsigned char *data, size_t length,
+                             size_t offset, uint64_t value) {
+   unsigned char bytes[8];
+   assert(offset + 8 <= length);
+   for (int i = 0; i < 8; i++)
+      bytes[i] = (unsigned char)(value >> (8 * i));
+
+   FILE *f = tmpfile();
+   assert(f != NULL);
+   assert(write(fileno(f), data, length) == (ssize_t)length);
+   assert(pwrite(fileno(f), bytes, 8, offset) == 8);
+   assert(lseek(fileno(f), 0, SEEK_SET) == 0);
+   gamma_t *g = gamma_load(fileno(f));
+   fclose(f);
+   return g;
+}
 
 /** @brief Główna funkcja testująca program.
  * @return Zwraca 0.
@@ -84,5 +174,245 @@ int main() {
    free(p);
    
    gamma_delete(g);
+
+   // Złoty ruch na punkcie artykulacji obszaru.
+   g = gamma_new(3, 2, 2, 1);
+   assert(g != NULL);
+   assert(gamma_move(g, 1, 0, 0));
+   assert(gamma_move(g, 1, 1, 0));
+   assert(gamma_move(g, 1, 2, 0));
+   assert(gamma_move(g, 2, 0, 1));
+
+   // Kopia gry jest niezależna od oryginału.
+   gamma_t *c = gamma_clone(g);
+   assert(c != NULL);
+   assert(gamma_golden_move(c, 2, 0, 0));
+   assert(gamma_busy_fields(c, 1) == 2);
+   assert(gamma_busy_fields(g, 1) == 3);
+   assert(gamma_clone_into(c, g));
+   assert(gamma_busy_fields(c, 1) == 3);
+   gamma_delete(c);
+
+   // Cofnięty złoty ruch przywraca poprzedni stan gry.
+   assert(gamma_set_undo(g, true));
+   assert(!gamma_undo(g));
+   uint64_t version = gamma_version(g), changed[2];
+   assert(gamma_golden_move(g, 2, 0, 0));
+   assert(!gamma_golden_possible(g, 2));
+   assert(gamma_undo(g));
+   assert(!gamma_undo(g));
+   assert(gamma_changes_since(g, version, changed, 2) == 2);
+   assert(changed[0] == 0 && changed[1] == 0);
+   assert(gamma_busy_fields(g, 1) == 3);
+   assert(gamma_busy_fields(g, 2) == 1);
+   p = gamma_board(g);
+   assert(p);
+   assert(strcmp(p, "2..\n111\n") == 0);
+   free(p);
+   assert(gamma_set_undo(g, false));
+
+   assert(gamma_golden_possible(g, 2));
+   assert(gamma_golden_possible(g, 1));
+   // Sprawdzenie złotego ruchu nie zmienia stanu gry.
+   assert(!gamma_golden_check(g, 2, 1, 0));
+   assert(gamma_golden_check(g, 2, 0, 0));
+   assert(!gamma_golden_check(g, 2, 0, 1));
+   assert(!gamma_golden_check(g, 2, 2, 1));
+   assert(gamma_busy_fields(g, 1) == 3);
+   gamma_stats_t stats[2];
+   assert(gamma_stats(g, stats));
+   assert(stats[0].busy == 3 && stats[0].free == 2 && stats[0].areas == 1);
+   assert(stats[1].busy == 1 && stats[1].free == 1 && stats[1].areas == 1);
+   assert(stats[0].golden && stats[1].golden);
+   assert(gamma_next_active_player(g, 0) == 1);
+   assert(gamma_next_active_player(g, 1) == 2);
+   assert(gamma_next_active_player(g, 2) == 1);
+   assert(gamma_next_active_player(g, 3) == 0);
+   assert(!gamma_is_over(g));
+   assert(!gamma_golden_move(g, 2, 1, 0));
+   assert(gamma_golden_possible(g, 2));
+   assert(gamma_golden_move(g, 2, 0, 0));
+   assert(!gamma_golden_possible(g, 2));
+   assert(gamma_busy_fields(g, 1) == 2);
+   assert(gamma_busy_fields(g, 2) == 2);
+
+   // Odczytana gra ma ten sam stan co zapisana.
+   int fd[2];
+   assert(pipe(fd) == 0);
+   assert(gamma_save(g, fd[1]));
+   close(fd[1]);
+   c = gamma_load(fd[0]);
+   assert(c != NULL);
+   assert(gamma_load(fd[0]) == NULL);
+   close(fd[0]);
+   p = gamma_board(c);
+   assert(p);
+   assert(strcmp(p, "2..\n211\n") == 0);
+   free(p);
+   assert(gamma_busy_fields(c, 2) == 2);
+   assert(gamma_free_fields(c, 1) == 2);
+   assert(!gamma_golden_possible(c, 2));
+   assert(gamma_move(c, 1, 1, 1));
+   assert(gamma_busy_fields(c, 1) == 3);
+   gamma_delete(c);
+
+   // Liczniki niezgodne z planszą odrzucają zapis. Po nagłówku leży liczba
+   // zajętych pól, a za nią po cztery liczniki każdego gracza: sąsiednie
+   // wolne pola, złoty ruch, obszary i pola.
+   FILE *f = tmpfile();
+   assert(f != NULL);
+   assert(gamma_save(g, fileno(f)));
+   size_t saved_length = lseek(fileno(f), 0, SEEK_END);
+   unsigned char *saved = malloc(saved_length);
+   assert(saved != NULL);
+   assert(pread(fileno(f), saved, saved_length, 0) == (ssize_t)saved_length);
+   fclose(f);
+   const size_t busy_at = 36, counters_at = 44;
+   c = load_patched(saved, saved_length, busy_at, 4);
+   assert(c != NULL);
+   gamma_delete(c);
+   assert(load_patched(saved, saved_length, busy_at, 0) == NULL);
+   assert(load_patched(saved, saved_length, counters_at + 32 + 24, 0) == NULL);
+   assert(load_patched(saved, saved_length, counters_at + 64 + 24, 3) == NULL);
+   assert(load_patched(saved, saved_length, counters_at + 32 + 16, 2) == NULL);
+   assert(load_patched(saved, saved_length, counters_at + 8, 1) == NULL);
+   free(saved);
+
+   // Wyczyszczona gra zachowuje się jak nowa.
+   gamma_reset(g);
+   assert(gamma_busy_fields(g, 1) == 0);
+   assert(gamma_busy_fields(g, 2) == 0);
+   assert(gamma_free_fields(g, 1) == 6);
+   assert(!gamma_golden_possible(g, 2));
+   p = gamma_board(g);
+   assert(p);
+   assert(strcmp(p, "...\n...\n") == 0);
+   free(p);
+   char text[9];
+   assert(gamma_board_into(g, text, 8) == 9);
+   assert(gamma_board_into(g, text, sizeof(text)) == 9);
+   assert(strcmp(text, "...\n...\n") == 0);
+   text[0] = '\0';
+   assert(gamma_board_write(g, append, text));
+   assert(strcmp(text, "...\n...\n") == 0);
+   assert(gamma_move(g, 2, 1, 0));
+   assert(!gamma_move(g, 2, 1, 2));
+   assert(!gamma_move(g, 2, 0, 1));
+   assert(gamma_move(g, 2, 1, 1));
+   assert(gamma_move(g, 1, 0, 0));
+   assert(gamma_golden_move(g, 1, 1, 0));
+   assert(gamma_busy_fields(g, 1) == 2);
+   gamma_delete(g);
+
+   // Gracz, który osiągnął limit obszarów, może zająć tylko pola sąsiednie.
+   g = gamma_new(3, 2, 2, 1);
+   assert(g != NULL);
+   assert(gamma_move(g, 1, 1, 0));
+   uint64_t moves[6], mask;
+   assert(gamma_legal_moves(g, 1, moves, 6) == 3);
+   assert(moves[0] == 0 && moves[1] == 2 && moves[2] == 4);
+   assert(gamma_legal_moves(g, 2, moves, 1) == 5);
+   assert(moves[0] == 0);
+   assert(gamma_legal_moves_mask(g, 1, &mask, 1));
+   assert(mask == 0x15);
+   assert(gamma_legal_moves_mask(g, 2, &mask, 1));
+   assert(mask == 0x3d);
+   gamma_delete(g);
+
+   // Gra na ogromnej planszy przechowuje tylko zajęte pola.
+   g = gamma_new(100000, 100000, 2, 2);
+   assert(g != NULL);
+   assert(gamma_move(g, 1, 0, 0));
+   assert(gamma_move(g, 1, 1, 0));
+   assert(gamma_move(g, 2, 99999, 99999));
+   assert(gamma_move(g, 2, 0, 1));
+   assert(!gamma_move(g, 2, 50000, 50000));
+   assert(gamma_free_fields(g, 1) == 10000000000 - 4);
+   assert(gamma_free_fields(g, 2) == 4);
+   assert(gamma_golden_possible(g, 1));
+   assert(gamma_golden_move(g, 1, 0, 1));
+   assert(gamma_busy_fields(g, 1) == 3);
+   assert(gamma_busy_fields(g, 2) == 1);
+   assert(!gamma_set_undo(g, true));
+   assert(!gamma_save(g, 1));
+   gamma_delete(g);
+
+   // Złote ruchy na ogromnej planszy wyznacza analiza zajętych pól.
+   g = gamma_new(100000, 100000, 3, 1);
+   assert(g != NULL);
+   for (uint32_t x = 0; x < 3; x++) {
+      assert(gamma_move(g, 1, x, 0));
+      assert(gamma_move(g, 2, x, 1));
+   }
+   assert(gamma_move(g, 3, 5, 5));
+   assert(gamma_golden_possible(g, 2));
+   assert(!gamma_golden_possible(g, 3));
+   assert(!gamma_golden_move(g, 2, 1, 0));
+   assert(gamma_golden_move(g, 2, 2, 0));
+   assert(!gamma_golden_possible(g, 2));
+   assert(gamma_golden_possible(g, 1));
+   assert(!gamma_golden_move(g, 1, 1, 1));
+   assert(gamma_golden_move(g, 1, 0, 1));
+   assert(!gamma_golden_possible(g, 1));
+   gamma_delete(g);
+
+   // Odrzucony złoty ruch nie czyści dziennika, nawet gdy skończyły się
+   // wolne węzły struktury find_union.
+   g = gamma_new(16, 1, 20, 1);
+   assert(g != NULL);
+   assert(gamma_set_undo(g, true));
+   for (uint32_t i = 0; i < 16; i++)
+      assert(gamma_move(g, 1, i, 0));
+   for (uint32_t i = 0; i < 11; i++)
+      assert(gamma_golden_move(g, i + 2, i, 0));
+   assert(!gamma_golden_move(g, 13, 13, 0));
+   assert(gamma_undo(g));
+   assert(gamma_busy_fields(g, 12) == 0);
+   assert(gamma_busy_fields(g, 1) == 6);
+   gamma_delete(g);
+
+   // Liczniki wolnych pól sąsiednich zgadzają się z płaszczyznami.
+   g = gamma_new(9, 7, 4, 2);
+   assert(g != NULL);
+   srand(1);
+   for (int i = 0; i < 400; i++) {
+      uint32_t player = 1 + rand() % 4;
+      if (rand() % 16 == 0)
+         gamma_golden_move(g, player, rand() % 9, rand() % 7);
+      else
+         gamma_move(g, player, rand() % 9, rand() % 7);
+      check_frontier(g, 9, 7, 4, 2);
+   }
+   gamma_delete(g);
+
+   // Gra kończy się, gdy żaden gracz nie może wykonać ruchu.
+   g = gamma_new(2, 1, 2, 1);
+   assert(g != NULL);
+   assert(gamma_move(g, 1, 0, 0));
+   assert(gamma_move(g, 2, 1, 0));
+   assert(gamma_next_active_player(g, 2) == 1);
+   assert(!gamma_is_over(g));
+   assert(gamma_golden_move(g, 1, 1, 0));
+   assert(gamma_next_active_player(g, 0) == 2);
+   assert(gamma_golden_move(g, 2, 0, 0));
+   assert(gamma_next_active_player(g, 0) == 0);
+   assert(gamma_is_over(g));
+   gamma_reset(g);
+   assert(gamma_next_active_player(g, 1) == 2);
+   gamma_delete(g);
+
+   // Gry wydawane przez pulę zaczynają się od pustej planszy.
+   gamma_pool_t *pool = gamma_pool_new(3, 2, 2, 1);
+   assert(pool != NULL);
+   g = gamma_pool_get(pool);
+   assert(g != NULL);
+   assert(gamma_move(g, 1, 0, 0));
+   gamma_pool_put(pool, g);
+   g = gamma_pool_get(pool);
+   assert(g != NULL);
+   assert(gamma_busy_fields(g, 1) == 0);
+   assert(gamma_move(g, 2, 0, 0));
+   gamma_pool_put(pool, g);
+   gamma_pool_delete(pool);
    return 0;
 }
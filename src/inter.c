@@ -438,45 +438,21 @@ static void skip_one_player() {
 }
 
 /** @brief Pomija wszystkich graczy, którzy nie mogą wykonać ruchu.
+ * Gra przechowuje zbiór graczy, którzy mogą wykonać ruch, więc gracze
+ * nie są sprawdzani po kolei.
  * @param[in] g - struktura przechowywująca stan gry.
  * @return Zwraca true jeśli wszyscy gracze zostali pominięci lub false w
  * przeciwnym przypadku.
  */
 static bool skip_players(gamma_t *g) {
-    uint32_t count2 = 1; 
-        
-    while (count2 <= inter.players && gamma_free_fields(g, count2) == 0
-           && gamma_golden_possible(g, count2) == false) {
-        count2++; 
-    }
-    
-    uint32_t player_num = inter.PLAYER;
-    
-    while (player_num <= inter.players && 
-           gamma_free_fields(g, player_num) == 0 &&
-           gamma_golden_possible(g, player_num) == false) {
-        player_num++;
-    }
-    
-    if (player_num == inter.players + 1) {
-        player_num = 1;
-        
-        while (player_num <= inter.PLAYER &&
-               gamma_free_fields(g, player_num) == 0 
-               && gamma_golden_possible(g, player_num) == false) {
-            player_num++;
-        }
-    }
-    
-    inter.PLAYER = player_num;
-    
     inter.count++; 
     inter.count %= 3;
     
-    if (count2 == inter.players + 1) {
+    if (gamma_is_over(g)) {
         return true;
     }
-
+    
+    inter.PLAYER = gamma_next_active_player(g, inter.PLAYER - 1);
     return false;
 }
 
@@ -0,0 +1,125 @@
+/** @file
+ * Implementacja interfejsu dziennika zmian pozwalającego cofać ruchy.
+ *
+ * @author Jakub Bedełek
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "journal.h"
+
+/**
+ * Struktura opisująca jeden zapis dziennika.
+ */
+typedef struct record record_t;
+
+/**
+ * Struktura opisująca jeden zapis dziennika. Zapis o adresie NULL jest
+ * znacznikiem początku ruchu.
+ */
+struct record {
+   void *addr;                  /**< Adres zmienianego pola. */
+   uint32_t bytes;              /**< Wielkość pola w bajtach. */
+};
+
+/**
+ * Struktura przechowująca dziennik zmian.
+ */
+struct journal {
+   record_t *records;           /**< Stos zapisów. */
+   uint64_t count;              /**< Liczba zapisów. */
+   uint64_t size;               /**< Pojemność stosu records. */
+   char *data;                  /**< Stos poprzednich zawartości pól. */
+   uint64_t used;               /**< Liczba zajętych bajtów stosu data. */
+   uint64_t capacity;           /**< Pojemność stosu data. */
+   bool failed;                 /**< Wartość true jeśli bieżącego ruchu nie
+                                     da się cofnąć. */
+};
+
+journal_t *journal_new(void) {
+   journal_t *j = malloc(sizeof(journal_t));
+   if (j == NULL)
+      return NULL;
+
+   j->records = NULL;
+   j->data = NULL;
+   j->count = j->size = 0;
+   j->used = j->capacity = 0;
+   j->failed = false;
+   return j;
+}
+
+void journal_delete(journal_t *j) {
+   if (j != NULL) {
+      free(j->records);
+      free(j->data);
+      free(j);
+   }
+}
+
+void journal_clear(journal_t *j) {
+   j->count = 0;
+   j->used = 0;
+}
+
+/** @brief Wkłada zapis na stos, w razie potrzeby powiększając stosy.
+ * @param[in,out] j   - wskaźnik na dziennik,
+ * @param[in] addr    - adres zmienianego pola lub NULL dla znacznika,
+ * @param[in] bytes   - wielkość pola w bajtach.
+ * @return Zwraca true jeśli udało się zaalokować pamięć lub false
+ * w przeciwnym przypadku.
+ */
+static bool push_record(journal_t *j, void *addr, uint32_t bytes) {
+   if (j->count == j->size) {
+      uint64_t new_size = j->size < 64 ? 64 : 2 * j->size;
+      record_t *records = realloc(j->records, new_size * sizeof(record_t));
+      if (records == NULL)
+         return false;
+      j->records = records;
+      j->size = new_size;
+   }
+   if (j->capacity - j->used < bytes) {
+      uint64_t new_capacity = j->capacity < 256 ? 256 : 2 * j->capacity;
+      char *data = realloc(j->data, new_capacity);
+      if (data == NULL)
+         return false;
+      j->data = data;
+      j->capacity = new_capacity;
+   }
+
+   j->records[j->count++] = (record_t){addr, bytes};
+   if (addr != NULL) {
+      memcpy(j->data + j->used, addr, bytes);
+      j->used += bytes;
+   }
+   return true;
+}
+
+void journal_mark(journal_t *j) {
+   j->failed = !push_record(j, NULL, 0);
+   if (j->failed)
+      journal_clear(j);
+}
+
+void journal_save(journal_t *j, void *addr, uint32_t bytes) {
+   if (j->failed)
+      return;
+   if (!push_record(j, addr, bytes)) {
+      journal_clear(j);
+      j->failed = true;
+   }
+}
+
+bool journal_undo(journal_t *j) {
+   if (j->count == 0)
+      return false;
+
+   while (j->count > 0) {
+      record_t *r = &j->records[--j->count];
+      if (r->addr == NULL)
+         break;
+      j->used -= r->bytes;
+      memcpy(r->addr, j->data + j->used, r->bytes);
+   }
+   return true;
+}
@@ -0,0 +1,61 @@
+/** @file
+ * Interfejs dziennika zmian pozwalającego cofać ruchy.
+ *
+ * Przed zmianą pola struktury zapisuje się w dzienniku jego adres
+ * i poprzednią zawartość. Znacznik oddziela zmiany kolejnych ruchów,
+ * a cofnięcie ruchu przywraca zawartość pól zapisanych po ostatnim
+ * znaczniku w odwrotnej kolejności.
+ *
+ * @author Jakub Bedełek
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Struktura przechowująca dziennik zmian.
+ */
+typedef struct journal journal_t;
+
+/** @brief Tworzy pusty dziennik.
+ * @return Zwraca wskaźnik na dziennik lub NULL, gdy nie udało się
+ * zaalokować pamięci.
+ */
+journal_t *journal_new(void);
+
+/** @brief Usuwa dziennik. Nic nie robi, jeśli @p j ma wartość NULL.
+ * @param[in] j       - wskaźnik na dziennik.
+ */
+void journal_delete(journal_t *j);
+
+/** @brief Usuwa wszystkie zapisy z dziennika.
+ * @param[in,out] j   - wskaźnik na dziennik.
+ */
+void journal_clear(journal_t *j);
+
+/** @brief Rozpoczyna zapisywanie zmian nowego ruchu.
+ * @param[in,out] j   - wskaźnik na dziennik.
+ */
+void journal_mark(journal_t *j);
+
+/** @brief Zapisuje obecną zawartość @p bytes bajtów pod adresem @p addr.
+ * Jeśli nie uda się zaalokować pamięci, dziennik zapomina wszystkie ruchy
+ * aż do następnego wywołania @ref journal_mark, bo bieżącego ruchu nie da
+ * się już cofnąć.
+ * @param[in,out] j   - wskaźnik na dziennik,
+ * @param[in] addr    - adres zmienianego pola,
+ * @param[in] bytes   - wielkość pola w bajtach.
+ */
+void journal_save(journal_t *j, void *addr, uint32_t bytes);
+
+/** @brief Cofa zmiany ostatniego ruchu.
+ * @param[in,out] j   - wskaźnik na dziennik.
+ * @return Zwraca true jeśli ruch został cofnięty lub false, jeśli
+ * w dzienniku nie ma żadnego ruchu.
+ */
+bool journal_undo(journal_t *j);
+
+#endif /* JOURNAL_H */
@@ -0,0 +1,261 @@
+/** @file
+ * Interfejs rozmieszczenia pól planszy w tablicach gry.
+ *
+ * Pola planszy razem z ramką szerokości jednego pola są numerowane tak,
+ * aby numer pola wyznaczał jego miejsce w planszy, płaszczyznach bitowych
+ * i tablicach struktury find_union. Domyślnie pola są numerowane wierszami.
+ * Jeśli zdefiniowano BOARD_TILED, pola są numerowane kafelkami 8x8 pól,
+ * a kafelki blokami 8x8 kafelków, w kolejności krzywej Mortona. Sąsiedzi
+ * pola w pionie leżą wtedy zwykle w tej samej linii pamięci podręcznej.
+ * Funkcje tego pliku są jedynym miejscem, które zna numerację, więc reszta
+ * gry działa z każdą z nich.
+ *
+ * @author Jakub Bedełek
+ */
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Liczba sąsiadów pola planszy. Kolejno: lewy, dolny, prawy i górny sąsiad.
+ */
+#define LAYOUT_NEIGHBOURS 4
+
+/**
+ * Numer prawego sąsiada, następnego pola w wierszu.
+ */
+#define LAYOUT_RIGHT 2
+
+#ifdef BOARD_TILED
+/**
+ * Wartość true, jeśli pola są numerowane wierszami.
+ */
+#define LAYOUT_ROW_MAJOR false
+
+/**
+ * Logarytm boku kafelka i boku bloku mierzonego w kafelkach.
+ */
+#define LAYOUT_BITS 3
+
+/**
+ * Bok kafelka w polach i bok bloku w kafelkach.
+ */
+#define LAYOUT_SIDE (1 << LAYOUT_BITS)
+
+/**
+ * Liczba pól kafelka i liczba kafelków bloku.
+ */
+#define LAYOUT_AREA (LAYOUT_SIDE * LAYOUT_SIDE)
+#else
+/**
+ * Wartość true, jeśli pola są numerowane wierszami.
+ */
+#define LAYOUT_ROW_MAJOR true
+#endif
+
+/**
+ * Struktura opisująca rozmieszczenie pól planszy.
+ */
+typedef struct layout_s layout_t;
+
+/**
+ * Struktura opisująca rozmieszczenie pól planszy.
+ */
+struct layout_s {
+   uint64_t columns;           /**< Liczba kolumn razem z ramką. */
+   uint64_t rows;              /**< Liczba wierszy razem z ramką. */
+   uint64_t size;              /**< Liczba numerów pól, razem z numerami
+                                    dopełniającymi ostatnie bloki. */
+   uint64_t blocks;            /**< Liczba bloków w wierszu bloków. */
+   int64_t shift[LAYOUT_NEIGHBOURS]; /**< Przesunięcia numerów sąsiednich
+                                    pól przy numeracji wierszami. */
+};
+
+#ifdef BOARD_TILED
+/** @brief Rozsuwa trzy bity liczby @p v na parzyste pozycje.
+ * @param[in] v       - liczba mniejsza od @ref LAYOUT_SIDE.
+ * @return Zwraca liczbę, której bit 2i jest bitem i liczby @p v.
+ */
+static inline uint64_t layout_spread(uint64_t v) {
+   return (v & 1) | (v & 2) << 1 | (v & 4) << 2;
+}
+
+/** @brief Zbiera parzyste bity liczby @p m, odwrotnie do
+ * @ref layout_spread.
+ * @param[in] m       - liczba mniejsza od @ref LAYOUT_AREA.
+ * @return Zwraca liczbę, której bit i jest bitem 2i liczby @p m.
+ */
+static inline uint64_t layout_gather(uint64_t m) {
+   return (m & 1) | (m >> 1 & 2) | (m >> 2 & 4);
+}
+#endif
+
+/** @brief Wyznacza rozmieszczenie pól planszy o @p columns kolumnach
+ * i @p rows wierszach, razem z ramką.
+ * @param[out] l      - wskaźnik na strukturę opisującą rozmieszczenie,
+ * @param[in] columns - liczba kolumn razem z ramką,
+ * @param[in] rows    - liczba wierszy razem z ramką.
+ * @return Zwraca true, jeśli numery pól mieszczą się w typie uint64_t.
+ */
+static inline bool layout_init(layout_t *l, uint64_t columns, uint64_t rows) {
+   l->columns = columns;
+   l->rows = rows;
+   l->shift[0] = -1;
+   l->shift[1] = -(int64_t)columns;
+   l->shift[2] = 1;
+   l->shift[3] = (int64_t)columns;
+#ifdef BOARD_TILED
+   uint64_t block = (uint64_t)LAYOUT_SIDE * LAYOUT_SIDE;
+   l->blocks = (columns + block - 1) / block;
+   uint64_t block_rows = (rows + block - 1) / block;
+   if (l->blocks > UINT64_MAX / block_rows / (block * block))
+      return false;
+   l->size = l->blocks * block_rows * block * block;
+#else
+   l->blocks = 1;
+   if (columns > UINT64_MAX / rows)
+      return false;
+   l->size = columns * rows;
+#endif
+   return true;
+}
+
+/** @brief Zwraca numer pola w kolumnie @p x i wierszu @p y, licząc
+ * kolumny i wiersze ramki.
+ * @param[in] l       - wskaźnik na strukturę opisującą rozmieszczenie,
+ * @param[in] x       - numer kolumny, mniejszy od l->columns,
+ * @param[in] y       - numer wiersza, mniejszy od l->rows.
+ * @return Zwraca numer pola.
+ */
+static inline uint64_t layout_cell(const layout_t *l, uint64_t x,
+                                   uint64_t y) {
+#ifdef BOARD_TILED
+   uint64_t block = (y >> (2 * LAYOUT_BITS)) * l->blocks +
+                    (x >> (2 * LAYOUT_BITS));
+   uint64_t tile = layout_spread(x >> LAYOUT_BITS & (LAYOUT_SIDE - 1)) |
+                   layout_spread(y >> LAYOUT_BITS & (LAYOUT_SIDE - 1)) << 1;
+   return (block * LAYOUT_AREA + tile) * LAYOUT_AREA +
+          (y & (LAYOUT_SIDE - 1)) * LAYOUT_SIDE + (x & (LAYOUT_SIDE - 1));
+#else
+   return y * l->columns + x;
+#endif
+}
+
+/** @brief Wyznacza kolumnę i wiersz pola o numerze @p num, licząc
+ * kolumny i wiersze ramki.
+ * @param[in] l       - wskaźnik na strukturę opisującą rozmieszczenie,
+ * @param[in] num     - numer pola,
+ * @param[out] x      - numer kolumny,
+ * @param[out] y      - numer wiersza.
+ */
+static inline void layout_coords(const layout_t *l, uint64_t num,
+                                 uint64_t *x, uint64_t *y) {
+#ifdef BOARD_TILED
+   uint64_t tile = num / LAYOUT_AREA % LAYOUT_AREA;
+   uint64_t block = num / LAYOUT_AREA / LAYOUT_AREA;
+   *x = (block % l->blocks) << (2 * LAYOUT_BITS) |
+        layout_gather(tile) << LAYOUT_BITS | (num & (LAYOUT_SIDE - 1));
+   *y = (block / l->blocks) << (2 * LAYOUT_BITS) |
+        layout_gather(tile >> 1) << LAYOUT_BITS |
+        (num / LAYOUT_SIDE & (LAYOUT_SIDE - 1));
+#else
+   *x = num % l->columns;
+   *y = num / l->columns;
+#endif
+}
+
+#ifdef BOARD_TILED
+/** @brief Zwraca numer sąsiada pola @p num leżącego w sąsiednim kafelku.
+ * Kafelki tego samego bloku różnią się numerem na krzywej Mortona,
+ * a sąsiednie bloki numerem bloku, więc wynik nie wymaga dzielenia.
+ * @param[in] l       - wskaźnik na strukturę opisującą rozmieszczenie,
+ * @param[in] num     - numer pola spoza ramki,
+ * @param[in] dir     - numer sąsiada.
+ * @return Zwraca numer sąsiada.
+ */
+static inline uint64_t layout_cross(const layout_t *l, uint64_t num,
+                                    int dir) {
+   uint64_t cell = num & (LAYOUT_AREA - 1);
+   uint64_t tile = num / LAYOUT_AREA % LAYOUT_AREA;
+   uint64_t block = num / LAYOUT_AREA / LAYOUT_AREA;
+   uint64_t tx = layout_gather(tile), ty = layout_gather(tile >> 1);
+   const uint64_t last = LAYOUT_SIDE - 1;
+
+   switch (dir) {
+      case 0:
+         cell += last;
+         tx = tx > 0 ? tx - 1 : (block--, last);
+         break;
+      case 1:
+         cell += last * LAYOUT_SIDE;
+         ty = ty > 0 ? ty - 1 : (block -= l->blocks, last);
+         break;
+      case 2:
+         cell -= last;
+         tx = tx < last ? tx + 1 : (block++, 0);
+         break;
+      default:
+         cell -= last * LAYOUT_SIDE;
+         ty = ty < last ? ty + 1 : (block += l->blocks, 0);
+         break;
+   }
+   tile = layout_spread(tx) | layout_spread(ty) << 1;
+   return (block * LAYOUT_AREA + tile) * LAYOUT_AREA + cell;
+}
+#endif
+
+/** @brief Zwraca numer sąsiada @p dir pola o numerze @p num.
+ * @param[in] l       - wskaźnik na strukturę opisującą rozmieszczenie,
+ * @param[in] num     - numer pola spoza ramki,
+ * @param[in] dir     - numer sąsiada, od 0 do @ref LAYOUT_NEIGHBOURS - 1.
+ * @return Zwraca numer sąsiada.
+ */
+static inline uint64_t layout_step(const layout_t *l, uint64_t num, int dir) {
+#ifdef BOARD_TILED
+   // Sąsiad leży zwykle w tym samym kafelku.
+   uint64_t x = num & (LAYOUT_SIDE - 1);
+   uint64_t y = num / LAYOUT_SIDE & (LAYOUT_SIDE - 1);
+   switch (dir) {
+      case 0:
+         return x > 0 ? num - 1 : layout_cross(l, num, dir);
+      case 1:
+         return y > 0 ? num - LAYOUT_SIDE : layout_cross(l, num, dir);
+      case 2:
+         return x < LAYOUT_SIDE - 1 ? num + 1 : layout_cross(l, num, dir);
+      default:
+         return y < LAYOUT_SIDE - 1 ? num + LAYOUT_SIDE :
+                                      layout_cross(l, num, dir);
+   }
+#else
+   return num + l->shift[dir];
+#endif
+}
+
+/** @brief Zwraca liczbę pól wiersza, które mają kolejne numery,
+ * zaczynając od pola o numerze @p num.
+ * @param[in] l       - wskaźnik na strukturę opisującą rozmieszczenie,
+ * @param[in] num     - numer pola.
+ * @return Zwraca liczbę pól, licząc pola ramki.
+ */
+static inline uint64_t layout_run(const layout_t *l, uint64_t num) {
+#ifdef BOARD_TILED
+   (void)l;
+   return LAYOUT_SIDE - (num & (LAYOUT_SIDE - 1));
+#else
+   return l->columns - num % l->columns;
+#endif
+}
+
+/**
+ * Zwraca numer następnego pola w wierszu po polu @p num spoza ramki.
+ */
+#ifdef BOARD_TILED
+#define LAYOUT_NEXT(l, num) layout_step((l), (num), LAYOUT_RIGHT)
+#else
+#define LAYOUT_NEXT(l, num) ((num) + 1)
+#endif
+
+#endif /* LAYOUT_H */
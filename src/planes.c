@@ -0,0 +1,83 @@
+/** @file
+ * Implementacja interfejsu płaszczyzn bitowych planszy.
+ *
+ * @author Jakub Bedełek
+ */
+
+#include <string.h>
+#include "planes.h"
+#include "arena.h"
+
+uint64_t planes_bytes(uint64_t size, uint32_t players) {
+   if (players > PLANES_MAX_PLAYERS)
+      return 0;
+   return arena_align(((uint64_t)players + 1) * ((size + 63) / 64) *
+                      sizeof(uint64_t));
+}
+
+void planes_init(planes_t *p, void *mem, uint64_t size, uint32_t players) {
+   p->bits = mem;
+   p->words = (size + 63) / 64;
+   p->count = players + 1;
+}
+
+void planes_fill(planes_t *p, const board_t *b, uint64_t size) {
+   memset(p->bits, 0, p->count * p->words * sizeof(uint64_t));
+   for (uint64_t i = 0; i < size; i++) {
+      uint32_t owner = board_get(b, i);
+      if (owner != 0)
+         *planes_word(p, 0, i) |= (uint64_t)1 << (i % 64);
+      if (owner != 0 && owner < p->count)
+         *planes_word(p, owner, i) |= (uint64_t)1 << (i % 64);
+   }
+}
+
+void planes_copy(planes_t *dst, const planes_t *src) {
+   memcpy(dst->bits, src->bits, src->count * src->words * sizeof(uint64_t));
+}
+
+/** @brief Zwraca słowo @p k płaszczyzny przesuniętej o @p s bitów
+ * w stronę większych numerów pól. Bity spoza płaszczyzny są zerami.
+ * @param[in] p       - wskaźnik na płaszczyzny,
+ * @param[in] plane   - numer płaszczyzny,
+ * @param[in] k       - numer słowa,
+ * @param[in] s       - przesunięcie, ujemne w stronę mniejszych numerów.
+ * @return Zwraca słowo, którego bit j jest bitem k * 64 + j - @p s
+ * płaszczyzny.
+ */
+static uint64_t shifted_word(const planes_t *p, uint32_t plane,
+                             uint64_t k, int64_t s) {
+   const uint64_t *bits = p->bits + plane;
+   uint64_t words = p->words;
+   // Bit j słowa wyniku pochodzi z bitu (k * 64 + j - s) płaszczyzny.
+   int64_t start = (int64_t)k * 64 - s;
+   int64_t q = start >= 0 ? start / 64 : -((-start + 63) / 64);
+   uint32_t r = (uint32_t)(start - q * 64);
+   uint64_t lo = q >= 0 && (uint64_t)q < words ? bits[q * p->count] : 0;
+   uint64_t hi = q + 1 >= 0 && (uint64_t)(q + 1) < words ?
+                 bits[(q + 1) * p->count] : 0;
+   return r == 0 ? lo : lo >> r | hi << (64 - r);
+}
+
+void planes_row(const planes_t *p, uint32_t plane, uint64_t num,
+                uint64_t count, uint64_t *mask) {
+   uint64_t n = (count + 63) / 64;
+   // Pola wolne są zgaszonymi bitami płaszczyzny zerowej.
+   uint64_t flip = plane == 0 ? UINT64_MAX : 0;
+   for (uint64_t k = 0; k < n; k++)
+      mask[k] = shifted_word(p, plane, k, -(int64_t)num) ^ flip;
+   if (count % 64 != 0)
+      mask[n - 1] &= ((uint64_t)1 << (count % 64)) - 1;
+}
+
+uint64_t planes_frontier(const planes_t *p, uint32_t plane, uint64_t stride) {
+   uint64_t count = 0;
+   for (uint64_t k = 0; k < p->words; k++) {
+      uint64_t near = shifted_word(p, plane, k, 1) |
+                      shifted_word(p, plane, k, -1) |
+                      shifted_word(p, plane, k, (int64_t)stride) |
+                      shifted_word(p, plane, k, -(int64_t)stride);
+      count += (uint64_t)__builtin_popcountll(~p->bits[k * p->count] & near);
+   }
+   return count;
+}
@@ -0,0 +1,138 @@
+/** @file
+ * Interfejs płaszczyzn bitowych planszy.
+ *
+ * Dla małej liczby graczy obok planszy przechowujemy jedną płaszczyznę
+ * bitową na gracza i płaszczyznę pól niewolnych. Bit o numerze pola
+ * planszy jest ustawiony w płaszczyźnie właściciela pola, a bit pola
+ * zajętego lub pola ramki także w płaszczyźnie zerowej, więc wyzerowane
+ * płaszczyzny opisują pustą planszę bez ramki. Zbiory pól, takie jak pola wolne sąsiadujące
+ * z polami gracza, liczy się wtedy operacjami na całych słowach.
+ * Słowa płaszczyzn opisujące te same 64 pola leżą obok siebie, więc ruch
+ * zmienia słowa w jednej linii pamięci podręcznej.
+ *
+ * @author Jakub Bedełek
+ */
+
+#ifndef PLANES_H
+#define PLANES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "board.h"
+
+/**
+ * Największa liczba graczy, dla której gra przechowuje płaszczyzny bitowe.
+ * Płaszczyzny zajmują wtedy co najwyżej 9 bitów na pole.
+ */
+#define PLANES_MAX_PLAYERS 8
+
+/**
+ * Struktura przechowująca płaszczyzny bitowe planszy.
+ */
+typedef struct planes_s planes_t;
+
+/**
+ * Struktura przechowująca płaszczyzny bitowe planszy.
+ */
+struct planes_s {
+   uint64_t *bits;             /**< Słowa płaszczyzn, po count słów na
+                                    64 pola, od płaszczyzny pól niewolnych,
+                                    lub NULL, jeśli gra ich nie
+                                    przechowuje. */
+   uint64_t words;             /**< Liczba słów jednej płaszczyzny. */
+   uint32_t count;             /**< Liczba płaszczyzn. */
+};
+
+/** @brief Zwraca liczbę bajtów płaszczyzn planszy o @p size polach dla
+ * @p players graczy.
+ * @param[in] size    - liczba pól planszy razem z ramką,
+ * @param[in] players - liczba graczy.
+ * @return Zwraca zero, jeśli graczy jest więcej niż
+ * @ref PLANES_MAX_PLAYERS, a w przeciwnym przypadku liczbę bajtów.
+ */
+uint64_t planes_bytes(uint64_t size, uint32_t players);
+
+/** @brief Tworzy płaszczyzny w obszarze pamięci @p mem. Wyzerowany
+ * obszar opisuje pustą planszę, na której trzeba jeszcze oznaczyć pola
+ * ramki funkcją @ref planes_border.
+ * @param[out] p      - wskaźnik na płaszczyzny,
+ * @param[in] mem     - obszar pamięci o wielkości @ref planes_bytes lub NULL,
+ *                      jeśli gra nie przechowuje płaszczyzn,
+ * @param[in] size    - liczba pól planszy razem z ramką,
+ * @param[in] players - liczba graczy.
+ */
+void planes_init(planes_t *p, void *mem, uint64_t size, uint32_t players);
+
+/** @brief Wypełnia płaszczyzny na podstawie planszy @p b.
+ * @param[in,out] p   - wskaźnik na płaszczyzny,
+ * @param[in] b       - plansza,
+ * @param[in] size    - liczba pól planszy razem z ramką.
+ */
+void planes_fill(planes_t *p, const board_t *b, uint64_t size);
+
+/** @brief Kopiuje płaszczyzny @p src do płaszczyzn @p dst utworzonych dla
+ * tej samej planszy i liczby graczy.
+ * @param[in,out] dst - wskaźnik na płaszczyzny, do których kopiujemy,
+ * @param[in] src     - wskaźnik na kopiowane płaszczyzny.
+ */
+void planes_copy(planes_t *dst, const planes_t *src);
+
+/** @brief Zwraca adres słowa płaszczyzny @p plane zawierającego bit pola
+ * @p num.
+ * @param[in] p       - wskaźnik na płaszczyzny,
+ * @param[in] plane   - numer płaszczyzny, 0 dla pól niewolnych,
+ * @param[in] num     - numer pola.
+ * @return Zwraca adres słowa.
+ */
+static inline uint64_t *planes_word(const planes_t *p, uint32_t plane,
+                                    uint64_t num) {
+   return p->bits + num / 64 * p->count + plane;
+}
+
+/** @brief Przenosi pole @p num z płaszczyzny @p from do płaszczyzny @p to.
+ * @param[in,out] p   - wskaźnik na płaszczyzny,
+ * @param[in] num     - numer pola,
+ * @param[in] from    - dotychczasowa wartość pola,
+ * @param[in] to      - nowa wartość pola.
+ */
+static inline void planes_move(planes_t *p, uint64_t num, uint32_t from,
+                               uint32_t to) {
+   // Bit pola jest ustawiony w płaszczyźnie from i zgaszony w płaszczyźnie
+   // to; dla pola wolnego jest to odwrotnie w płaszczyźnie zerowej.
+   uint64_t bit = (uint64_t)1 << (num % 64);
+   *planes_word(p, from, num) ^= bit;
+   *planes_word(p, to, num) ^= bit;
+}
+
+/** @brief Oznacza pole ramki @p num jako niewolne.
+ * @param[in,out] p   - wskaźnik na płaszczyzny,
+ * @param[in] num     - numer pola ramki.
+ */
+static inline void planes_border(planes_t *p, uint64_t num) {
+   *planes_word(p, 0, num) |= (uint64_t)1 << (num % 64);
+}
+
+/** @brief Zapisuje w masce @p mask bity płaszczyzny @p plane dla @p count
+ * kolejnych pól, zaczynając od pola o numerze @p num. Maska ma ten sam
+ * układ co maska funkcji @ref board_mask.
+ * @param[in] p       - wskaźnik na płaszczyzny,
+ * @param[in] plane   - numer płaszczyzny, 0 dla pól wolnych,
+ * @param[in] num     - numer pierwszego pola,
+ * @param[in] count   - liczba pól,
+ * @param[out] mask   - tablica (@p count + 63) / 64 słów.
+ */
+void planes_row(const planes_t *p, uint32_t plane, uint64_t num,
+                uint64_t count, uint64_t *mask);
+
+/** @brief Liczy wolne pola sąsiadujące z polami płaszczyzny @p plane.
+ * Sąsiadów wszystkich pól wyznacza przesunięciami całej płaszczyzny
+ * o jeden bit i o długość wiersza, więc przechodzi po każdym słowie
+ * płaszczyzny raz. Wymaga numeracji pól wierszami.
+ * @param[in] p       - wskaźnik na płaszczyzny,
+ * @param[in] plane   - numer płaszczyzny gracza,
+ * @param[in] stride  - długość wiersza planszy razem z ramką.
+ * @return Zwraca liczbę wolnych pól sąsiadujących z polami płaszczyzny.
+ */
+uint64_t planes_frontier(const planes_t *p, uint32_t plane, uint64_t stride);
+
+#endif /* PLANES_H */
@@ -0,0 +1,107 @@
+/** @file
+ * Implementacja interfejsu zapisu i odczytu liczb w binarnym zapisie
+ * stanu gry.
+ *
+ * @author Jakub Bedełek
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include "snapshot.h"
+
+/**
+ * Wielkość bufora, przez który są przepisywane liczby na komputerach
+ * big-endian.
+ */
+#define SWAP_BUFFER 4096
+
+/** @brief Zapisuje @p length bajtów, powtarzając przerwane i niepełne
+ * zapisy.
+ * @param[in] fd      - deskryptor pliku,
+ * @param[in] data    - bajty do zapisania,
+ * @param[in] length  - liczba bajtów.
+ * @return Zwraca true jeśli udało się zapisać wszystkie bajty.
+ */
+static bool write_all(int fd, const char *data, uint64_t length) {
+   while (length > 0) {
+      ssize_t done = write(fd, data, length);
+      if (done < 0 && errno == EINTR)
+         continue;
+      if (done <= 0)
+         return false;
+      data += done;
+      length -= (uint64_t)done;
+   }
+   return true;
+}
+
+/** @brief Odczytuje @p length bajtów, powtarzając przerwane i niepełne
+ * odczyty.
+ * @param[in] fd      - deskryptor pliku,
+ * @param[out] data   - miejsce na bajty,
+ * @param[in] length  - liczba bajtów.
+ * @return Zwraca true jeśli udało się odczytać wszystkie bajty.
+ */
+static bool read_all(int fd, char *data, uint64_t length) {
+   while (length > 0) {
+      ssize_t done = read(fd, data, length);
+      if (done < 0 && errno == EINTR)
+         continue;
+      if (done <= 0)
+         return false;
+      data += done;
+      length -= (uint64_t)done;
+   }
+   return true;
+}
+
+/** @brief Sprawdza, czy komputer zapisuje liczby w kolejności
+ * little-endian.
+ * @return Zwraca true dla komputerów little-endian.
+ */
+static bool little_endian(void) {
+   const uint16_t one = 1;
+   return *(const char *)&one == 1;
+}
+
+/** @brief Odwraca kolejność bajtów każdej z @p count liczb.
+ * @param[in,out] data - tablica liczb,
+ * @param[in] count   - liczba liczb,
+ * @param[in] bytes   - wielkość liczby.
+ */
+static void swap_bytes(char *data, uint64_t count, uint32_t bytes) {
+   for (uint64_t i = 0; i < count; i++, data += bytes) {
+      for (uint32_t j = 0; j < bytes / 2; j++) {
+         char c = data[j];
+         data[j] = data[bytes - 1 - j];
+         data[bytes - 1 - j] = c;
+      }
+   }
+}
+
+bool snapshot_write(int fd, const void *data, uint64_t count, uint32_t bytes) {
+   if (bytes == 1 || little_endian())
+      return write_all(fd, data, count * bytes);
+
+   char buffer[SWAP_BUFFER];
+   const char *next = data;
+   uint64_t step = SWAP_BUFFER / bytes;
+   for (uint64_t i = 0; i < count; i += step) {
+      uint64_t n = count - i < step ? count - i : step;
+      memcpy(buffer, next, n * bytes);
+      swap_bytes(buffer, n, bytes);
+      if (!write_all(fd, buffer, n * bytes))
+         return false;
+      next += n * bytes;
+   }
+   return true;
+}
+
+bool snapshot_read(int fd, void *data, uint64_t count, uint32_t bytes) {
+   if (!read_all(fd, data, count * bytes))
+      return false;
+   if (bytes > 1 && !little_endian())
+      swap_bytes(data, count, bytes);
+   return true;
+}
@@ -0,0 +1,40 @@
+/** @file
+ * Interfejs zapisu i odczytu liczb w binarnym zapisie stanu gry.
+ *
+ * Liczby są zapisywane w kolejności bajtów little-endian, niezależnie od
+ * kolejności bajtów komputera, więc zapis stanu gry można odczytać na
+ * innym komputerze. Na komputerach little-endian tablice są zapisywane
+ * i odczytywane w całości, bez kopiowania.
+ *
+ * @author Jakub Bedełek
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Zapisuje do deskryptora pliku @p fd tablicę @p count liczb
+ * o wielkości @p bytes bajtów.
+ * @param[in] fd      - deskryptor pliku otwartego do zapisu,
+ * @param[in] data    - tablica liczb,
+ * @param[in] count   - liczba liczb,
+ * @param[in] bytes   - wielkość liczby: 1, 2, 4 lub 8 bajtów.
+ * @return Zwraca true jeśli udało się zapisać wszystkie liczby lub false
+ * w przeciwnym przypadku.
+ */
+bool snapshot_write(int fd, const void *data, uint64_t count, uint32_t bytes);
+
+/** @brief Odczytuje z deskryptora pliku @p fd tablicę @p count liczb
+ * o wielkości @p bytes bajtów.
+ * @param[in] fd      - deskryptor pliku otwartego do odczytu,
+ * @param[out] data   - tablica na liczby,
+ * @param[in] count   - liczba liczb,
+ * @param[in] bytes   - wielkość liczby: 1, 2, 4 lub 8 bajtów.
+ * @return Zwraca true jeśli udało się odczytać wszystkie liczby lub false,
+ * jeśli plik skończył się wcześniej lub wystąpił błąd odczytu.
+ */
+bool snapshot_read(int fd, void *data, uint64_t count, uint32_t bytes);
+
+#endif /* SNAPSHOT_H */
@@ -0,0 +1,152 @@
+/** @file
+ * Implementacja interfejsu tablicy haszującej numery pól planszy.
+ *
+ * @author Jakub Bedełek
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sparse.h"
+
+/**
+ * Najmniejsza pojemność tablicy.
+ */
+#define SPARSE_MIN_CAPACITY 64
+
+/**
+ * Mnożnik haszowania Fibonacciego, zaokrąglone 2^64 / φ.
+ */
+#define SPARSE_MULTIPLIER 0x9E3779B97F4A7C15ull
+
+/** @brief Zwraca numer wpisu, od którego szukamy pola @p key.
+ * Numery sąsiednich pól różnią się o 1 lub o długość wiersza, więc bierzemy
+ * starsze bity iloczynu, na które wpływają wszystkie młodsze bity numeru.
+ * @param[in] s       - wskaźnik na tablicę o niezerowej pojemności,
+ * @param[in] key     - numer pola.
+ * @return Zwraca numer wpisu mniejszy od pojemności tablicy.
+ */
+static uint64_t home(const sparse_t *s, uint64_t key) {
+   return (key * SPARSE_MULTIPLIER) >> 32 & (s->capacity - 1);
+}
+
+/** @brief Wstawia wpis do tablicy, w której jest na niego miejsce.
+ * @param[in,out] s   - wskaźnik na tablicę,
+ * @param[in] key     - numer pola,
+ * @param[in] value   - wartość.
+ */
+static void place(sparse_t *s, uint64_t key, uint32_t value) {
+   uint64_t i = home(s, key);
+   while (s->entries[i].key != SPARSE_EMPTY && s->entries[i].key != key)
+      i = (i + 1) & (s->capacity - 1);
+   if (s->entries[i].key == SPARSE_EMPTY)
+      s->count++;
+   s->entries[i] = (sparse_entry_t){key, value};
+}
+
+/** @brief Przenosi wpisy do nowej tablicy o pojemności @p capacity.
+ * @param[in,out] s   - wskaźnik na tablicę,
+ * @param[in] capacity - nowa pojemność, potęga dwójki większa od
+ *                       podwojonej liczby wpisów.
+ * @return Zwraca true jeśli udało się zaalokować pamięć.
+ */
+static bool rehash(sparse_t *s, uint64_t capacity) {
+   sparse_entry_t *entries = malloc(capacity * sizeof(sparse_entry_t));
+   if (entries == NULL)
+      return false;
+   for (uint64_t i = 0; i < capacity; i++)
+      entries[i].key = SPARSE_EMPTY;
+
+   sparse_t old = *s;
+   s->entries = entries;
+   s->capacity = capacity;
+   s->count = 0;
+   for (uint64_t i = 0; i < old.capacity; i++) {
+      if (old.entries[i].key != SPARSE_EMPTY)
+         place(s, old.entries[i].key, old.entries[i].value);
+   }
+   free(old.entries);
+   return true;
+}
+
+void sparse_init(sparse_t *s) {
+   s->entries = NULL;
+   s->capacity = s->count = 0;
+}
+
+void sparse_free(sparse_t *s) {
+   free(s->entries);
+   sparse_init(s);
+}
+
+void sparse_clear(sparse_t *s) {
+   for (uint64_t i = 0; i < s->capacity; i++)
+      s->entries[i].key = SPARSE_EMPTY;
+   s->count = 0;
+}
+
+uint32_t *sparse_slot(const sparse_t *s, uint64_t key) {
+   if (s->count == 0)
+      return NULL;
+   uint64_t i = home(s, key);
+   while (s->entries[i].key != key) {
+      if (s->entries[i].key == SPARSE_EMPTY)
+         return NULL;
+      i = (i + 1) & (s->capacity - 1);
+   }
+   return &s->entries[i].value;
+}
+
+bool sparse_reserve(sparse_t *s, uint64_t count) {
+   // Tablica jest zapełniona co najwyżej w połowie, więc szukanie kończy
+   // się po kilku próbach.
+   uint64_t capacity = s->capacity < SPARSE_MIN_CAPACITY ?
+                       SPARSE_MIN_CAPACITY : s->capacity;
+   while (2 * (s->count + count) > capacity) {
+      if (capacity > UINT64_MAX / 2 / sizeof(sparse_entry_t))
+         return false;
+      capacity *= 2;
+   }
+   return capacity == s->capacity || rehash(s, capacity);
+}
+
+bool sparse_put(sparse_t *s, uint64_t key, uint32_t value) {
+   uint32_t *slot = sparse_slot(s, key);
+   if (slot != NULL) {
+      *slot = value;
+      return true;
+   }
+   if (!sparse_reserve(s, 1))
+      return false;
+   place(s, key, value);
+   return true;
+}
+
+bool sparse_copy(sparse_t *dst, const sparse_t *src) {
+   if (dst->capacity != src->capacity) {
+      sparse_entry_t *entries = malloc(src->capacity *
+                                       sizeof(sparse_entry_t));
+      if (src->capacity > 0 && entries == NULL)
+         return false;
+      free(dst->entries);
+      dst->entries = entries;
+      dst->capacity = src->capacity;
+   }
+   if (src->capacity > 0)
+      memcpy(dst->entries, src->entries,
+             src->capacity * sizeof(sparse_entry_t));
+   dst->count = src->count;
+   return true;
+}
+
+bool sparse_next(const sparse_t *s, uint64_t *pos, uint64_t *key,
+                 uint32_t *value) {
+   for (; *pos < s->capacity; (*pos)++) {
+      if (s->entries[*pos].key != SPARSE_EMPTY) {
+         *key = s->entries[*pos].key;
+         *value = s->entries[*pos].value;
+         (*pos)++;
+         return true;
+      }
+   }
+   return false;
+}
@@ -0,0 +1,116 @@
+/** @file
+ * Interfejs tablicy haszującej numery pól planszy.
+ *
+ * Rzadka plansza przechowuje tylko pola, które zostały zajęte, więc jej
+ * pamięć rośnie z liczbą ruchów, a nie z wielkością planszy. Tablica
+ * przypisuje 64-bitowym numerom pól 32-bitowe wartości i używa adresowania
+ * otwartego z liniowym próbkowaniem, więc kolejne próby czytają sąsiednie
+ * wpisy.
+ *
+ * @author Jakub Bedełek
+ */
+
+#ifndef SPARSE_H
+#define SPARSE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Struktura przechowująca tablicę haszującą.
+ */
+typedef struct sparse_s sparse_t;
+
+/**
+ * Struktura opisująca jeden wpis tablicy haszującej.
+ */
+typedef struct sparse_entry_s sparse_entry_t;
+
+/**
+ * Struktura opisująca jeden wpis tablicy haszującej.
+ */
+struct sparse_entry_s {
+   uint64_t key;               /**< Numer pola lub @ref SPARSE_EMPTY. */
+   uint32_t value;             /**< Wartość przypisana polu. */
+};
+
+/**
+ * Struktura przechowująca tablicę haszującą.
+ */
+struct sparse_s {
+   sparse_entry_t *entries;    /**< Wpisy tablicy lub NULL, jeśli tablica
+                                    nie ma jeszcze wpisów. */
+   uint64_t capacity;          /**< Liczba wpisów, potęga dwójki lub 0. */
+   uint64_t count;             /**< Liczba zajętych wpisów. */
+};
+
+/**
+ * Klucz wolnego wpisu. Numer pola jest mniejszy od liczby pól planszy,
+ * więc nigdy nie jest równy tej wartości.
+ */
+#define SPARSE_EMPTY UINT64_MAX
+
+/** @brief Tworzy pustą tablicę bez alokowania pamięci.
+ * @param[out] s      - wskaźnik na tablicę.
+ */
+void sparse_init(sparse_t *s);
+
+/** @brief Zwalnia pamięć tablicy. Tablica staje się pusta.
+ * @param[in,out] s   - wskaźnik na tablicę.
+ */
+void sparse_free(sparse_t *s);
+
+/** @brief Usuwa wszystkie wpisy tablicy, zachowując jej pojemność.
+ * @param[in,out] s   - wskaźnik na tablicę.
+ */
+void sparse_clear(sparse_t *s);
+
+/** @brief Zwraca adres wartości przypisanej polu @p key.
+ * @param[in] s       - wskaźnik na tablicę,
+ * @param[in] key     - numer pola.
+ * @return Zwraca adres wartości lub NULL, jeśli pole nie ma wpisu. Adres
+ * jest ważny do następnego wstawienia wpisu.
+ */
+uint32_t *sparse_slot(const sparse_t *s, uint64_t key);
+
+/** @brief Zapewnia miejsce na @p count nowych wpisów, tak aby kolejne
+ * wstawienia nie musiały alokować pamięci.
+ * @param[in,out] s   - wskaźnik na tablicę,
+ * @param[in] count   - liczba nowych wpisów.
+ * @return Zwraca true jeśli jest miejsce na wpisy lub false, jeśli nie
+ * udało się zaalokować pamięci.
+ */
+bool sparse_reserve(sparse_t *s, uint64_t count);
+
+/** @brief Przypisuje polu @p key wartość @p value, dodając wpis, jeśli
+ * pole go nie ma.
+ * @param[in,out] s   - wskaźnik na tablicę,
+ * @param[in] key     - numer pola,
+ * @param[in] value   - nowa wartość.
+ * @return Zwraca true jeśli przypisano wartość lub false, jeśli nie udało
+ * się zaalokować pamięci. Po wywołaniu @ref sparse_reserve kolejne
+ * wstawienia się udają.
+ */
+bool sparse_put(sparse_t *s, uint64_t key, uint32_t value);
+
+/** @brief Kopiuje wpisy tablicy @p src do tablicy @p dst.
+ * @param[in,out] dst - wskaźnik na tablicę, do której kopiujemy,
+ * @param[in] src     - wskaźnik na kopiowaną tablicę.
+ * @return Zwraca true jeśli udało się skopiować wpisy lub false, jeśli nie
+ * udało się zaalokować pamięci. Wtedy tablica @p dst się nie zmienia.
+ */
+bool sparse_copy(sparse_t *dst, const sparse_t *src);
+
+/** @brief Przechodzi po wpisach tablicy w dowolnej kolejności.
+ * @param[in] s       - wskaźnik na tablicę,
+ * @param[in,out] pos - pozycja, od której szukamy wpisu, na początku 0,
+ *                      przesuwana za znaleziony wpis,
+ * @param[out] key    - numer pola wpisu,
+ * @param[out] value  - wartość wpisu.
+ * @return Zwraca true jeśli znaleziono wpis lub false, jeśli nie ma już
+ * wpisów.
+ */
+bool sparse_next(const sparse_t *s, uint64_t *pos, uint64_t *key,
+                 uint32_t *value);
+
+#endif /* SPARSE_H */